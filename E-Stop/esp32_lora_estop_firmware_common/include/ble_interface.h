@@ -1,6 +1,6 @@
 #pragma once
 
-#include "comm_interface.h"
+#include "comm_transport.h"
 #include <NimBLEAddress.h>
 #include <cstdint>
 #include <vector>
@@ -36,6 +36,53 @@ public:
 
   virtual int8_t getRSSI( const NimBLEAddress &address ) const = 0;
 
-  virtual void setProperty( uint8_t id, const std::vector<uint8_t> &data ) = 0;
-  virtual void readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const = 0;
-};
\ No newline at end of file
+  virtual void setProperty( uint8_t id, const PropertyValue &data ) = 0;
+  virtual void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const = 0;
+};
+
+//! The connection of a BLEInterface to a single peer as a transport.
+class BLETransport : public TransportInterface
+{
+public:
+  BLETransport( BLEInterface *ble_interface, const NimBLEAddress &peer_address )
+      : ble_interface_( ble_interface ), peer_address_( peer_address )
+  {
+  }
+
+  CommTransport getTransportType() const override { return CommTransport::BLE; }
+
+  void update() override
+  {
+    if ( ble_interface_ != nullptr )
+      ble_interface_->update();
+  }
+
+  CommState getCommState() const override
+  {
+    return ble_interface_ != nullptr ? ble_interface_->getCommState( peer_address_ )
+                                     : CommState::DISCONNECTED;
+  }
+
+  float getRSSI() const override
+  {
+    return ble_interface_ != nullptr ? ble_interface_->getRSSI( peer_address_ ) : 0.0f;
+  }
+
+  void setProperty( uint8_t id, const PropertyValue &data ) override
+  {
+    if ( ble_interface_ != nullptr )
+      ble_interface_->setProperty( id, data );
+  }
+
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override
+  {
+    data.clear();
+    age_ms = ULONG_MAX;
+    if ( ble_interface_ != nullptr )
+      ble_interface_->readProperty( id, data, age_ms );
+  }
+
+private:
+  BLEInterface *ble_interface_;
+  NimBLEAddress peer_address_;
+};
@@ -31,6 +31,15 @@ enum class CommState : uint8_t {
   ERROR = 10,
 };
 
+//! Packet counters of a transport for the E-Stop property received from the sender.
+struct LinkStatistics {
+  uint32_t received = 0;
+  //! Gaps in the sequence. Not counted for transports that only send the latest state.
+  uint32_t lost = 0;
+  //! Discarded because a newer packet already arrived using the same transport.
+  uint32_t reordered = 0;
+};
+
 struct CommStatus {
   uint32_t last_received_message_age_ms = UINT32_MAX;
   int8_t ble_rssi = 0;
@@ -39,6 +48,31 @@ struct CommStatus {
   CommState ble_state = CommState::DISCONNECTED;
   CommState esp_now_state = CommState::DISCONNECTED;
   CommState radio_state = CommState::DISCONNECTED;
+  LinkStatistics ble_statistics;
+  LinkStatistics esp_now_statistics;
+  LinkStatistics radio_statistics;
+};
+
+enum class CommTransport : uint8_t {
+  NONE = 0,
+  LORA = 1,
+  BLE = 2,
+  ESP_NOW = 3,
+};
+
+//! Tracing information of the E-Stop state used to measure its latency from sender to host.
+struct EStopTrace {
+  //! Incremented by the sender with every change and resend, the same packet sent using multiple
+  //! transports has the same sequence.
+  uint8_t sequence = 0;
+  //! The transport the state was received with first.
+  CommTransport transport = CommTransport::NONE;
+  //! Whether the sender time is known. LoRa only carries the sequence to keep the airtime short.
+  bool sender_time_valid = false;
+  //! Sender clock time in ms when the state was sent. Refreshed with every periodic resend.
+  uint32_t sender_time_ms = 0;
+  //! Receiver clock time in ms when the state was received.
+  uint32_t receive_time_ms = 0;
 };
 
 enum class CommMode {
@@ -51,9 +85,12 @@ static constexpr uint8_t COMM_PROPERTY_ID_SOFT_ESTOP = 0x01;
 static constexpr uint8_t COMM_PROPERTY_ID_BATTERY = 0x02;
 static constexpr uint8_t COMM_PROPERTY_ID_DEADMAN_ACTIVE = 0x03;
 static constexpr uint8_t COMM_PROPERTY_ID_DEADMAN_TRIGGERED = 0x04;
+//! LoRa configuration of the receiver and the one it requests, see lora_link_adaptation.h.
+static constexpr uint8_t COMM_PROPERTY_ID_LORA_LINK = 0x05;
 static constexpr uint8_t COMM_PROPERTY_UUIDS[] = {
     COMM_PROPERTY_ID_ESTOP, COMM_PROPERTY_ID_SOFT_ESTOP, COMM_PROPERTY_ID_BATTERY,
-    COMM_PROPERTY_ID_DEADMAN_ACTIVE, COMM_PROPERTY_ID_DEADMAN_TRIGGERED };
+    COMM_PROPERTY_ID_DEADMAN_ACTIVE, COMM_PROPERTY_ID_DEADMAN_TRIGGERED,
+    COMM_PROPERTY_ID_LORA_LINK };
 static constexpr int NUM_COMM_PROPERTIES =
     sizeof( COMM_PROPERTY_UUIDS ) / sizeof( COMM_PROPERTY_UUIDS[0] );
 
@@ -70,7 +107,11 @@ public:
   CommStatus update();
 
   bool getEStopState() const;
+  //! Sends the E-Stop state stamped with the next sequence number and the current time. Unchanged
+  //! states are only sent again after ESTOP_RESEND_INTERVAL_MS, see EStopSequencer.
   void setEStopState( bool active );
+  //! The trace of the received E-Stop state. Only available in SERVER mode.
+  EStopTrace getEStopTrace() const;
   bool getSoftEStopState() const;
   void setSoftEStopState( bool active );
   void reportBatteryLevel( uint8_t level );
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "comm_interface.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+//! A transport is disconnected if nothing was received from the peer for this long.
+static constexpr unsigned long COMM_CONNECTION_TIMEOUT_MS = 500;
+
+//! Added to the airtime of a LoRa packet when compensating the age of LoRa properties.
+static constexpr unsigned long LORA_TRANSMIT_MARGIN_MS = 10;
+
+//! Compensation for a LoraFrame at SF9, 125 kHz and coding rate 4/7, which is on air for about
+//! 140 ms. Used by the link simulator, the LoraInterface uses the airtime of its configuration.
+static constexpr unsigned long LORA_TRANSMIT_DURATION_MS = 140 + LORA_TRANSMIT_MARGIN_MS;
+
+//! The LoRa server only sends every few seconds due to the duty cycle, see lora_duty_cycle.h.
+static constexpr unsigned long LORA_CONNECTION_TIMEOUT_MS = 6000;
+
+//! Capacity of a property value. The largest property is the E-Stop state with its trace.
+static constexpr size_t MAX_PROPERTY_SIZE = 8;
+
+/*!
+ * Property value with a fixed capacity that is stored inline.
+ * Setting, sending, receiving and reading properties does not allocate, which matters as the values
+ * are updated every few ms and from radio callbacks. Longer values are truncated to the capacity.
+ */
+class PropertyValue
+{
+public:
+  PropertyValue() = default;
+
+  PropertyValue( std::initializer_list<uint8_t> values ) { assign( values.begin(), values.size() ); }
+
+  PropertyValue( const uint8_t *data, size_t size ) { assign( data, size ); }
+
+  void assign( const uint8_t *data, size_t size )
+  {
+    size_ = static_cast<uint8_t>( std::min( size, MAX_PROPERTY_SIZE ) );
+    std::copy( data, data + size_, data_ );
+  }
+
+  void clear() { size_ = 0; }
+
+  bool empty() const { return size_ == 0; }
+
+  size_t size() const { return size_; }
+
+  static constexpr size_t capacity() { return MAX_PROPERTY_SIZE; }
+
+  const uint8_t *data() const { return data_; }
+
+  const uint8_t *begin() const { return data_; }
+
+  const uint8_t *end() const { return data_ + size_; }
+
+  uint8_t operator[]( size_t index ) const { return data_[index]; }
+
+  bool operator==( const PropertyValue &other ) const
+  {
+    return size_ == other.size_ && std::equal( begin(), end(), other.begin() );
+  }
+
+  bool operator!=( const PropertyValue &other ) const { return !( *this == other ); }
+
+private:
+  uint8_t data_[MAX_PROPERTY_SIZE] = {};
+  uint8_t size_ = 0;
+};
+
+/*!
+ * A link to the peer that the properties are exchanged with, e.g., LoRa, BLE or ESP-NOW.
+ * Does not depend on the Arduino framework, so the arbitration between the transports can be
+ * compiled and tested natively using the LoopbackTransport.
+ */
+class TransportInterface
+{
+public:
+  virtual ~TransportInterface() = default;
+
+  //! The type of the transport reported in traces.
+  virtual CommTransport getTransportType() const = 0;
+
+  virtual void update() = 0;
+
+  virtual CommState getCommState() const = 0;
+
+  virtual float getRSSI() const = 0;
+
+  //! Time in ms to add to the age of received properties to compensate for a long transmission.
+  virtual unsigned long getTransmitDurationMs() const { return 0; }
+
+  //! Whether every property update is sent. Otherwise, only the latest value is sent when the
+  //! transport is free and gaps in the sequence of received properties are expected.
+  virtual bool sendsEveryUpdate() const { return true; }
+
+  virtual void setProperty( uint8_t id, const PropertyValue &data ) = 0;
+
+  //! Reads the last received value of the property. age_ms is ULONG_MAX if it was never received.
+  virtual void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const = 0;
+};
+
+/*!
+ * Reads the most recently received value of a property from all connected transports.
+ * The age includes the transmit duration of the transport. If multiple transports have the same
+ * age, the first one wins.
+ * @return The transport the value was read from or nullptr if no connected transport has a value.
+ */
+inline TransportInterface *readNewestProperty( TransportInterface *const *transports, size_t count,
+                                               uint8_t id, PropertyValue &data,
+                                               unsigned long &age_ms )
+{
+  TransportInterface *newest = nullptr;
+  PropertyValue value;
+  age_ms = ULONG_MAX;
+  for ( size_t i = 0; i < count; ++i ) {
+    TransportInterface *transport = transports[i];
+    if ( transport == nullptr || transport->getCommState() != CommState::CONNECTED )
+      continue;
+    unsigned long transport_age_ms = ULONG_MAX;
+    transport->readProperty( id, value, transport_age_ms );
+    if ( transport_age_ms == ULONG_MAX )
+      continue;
+    const unsigned long transmit_duration_ms = transport->getTransmitDurationMs();
+    transport_age_ms = transport_age_ms > ULONG_MAX - transmit_duration_ms
+                           ? ULONG_MAX - 1
+                           : transport_age_ms + transmit_duration_ms;
+    if ( transport_age_ms < age_ms ) {
+      age_ms = transport_age_ms;
+      data = value;
+      newest = transport;
+    }
+  }
+  return newest;
+}
+
+/*!
+ * In-memory transport for tests and benchmarks without radio hardware.
+ * Properties set on one endpoint are received by the connected endpoint. Each endpoint has its own
+ * clock which is set explicitly using setTime.
+ */
+class LoopbackTransport : public TransportInterface
+{
+public:
+  explicit LoopbackTransport( CommTransport type = CommTransport::NONE,
+                              unsigned long transmit_duration_ms = 0 )
+      : type_( type ), transmit_duration_ms_( transmit_duration_ms )
+  {
+  }
+
+  //! Connects two endpoints. Properties set on one of them are received by the other.
+  static void connect( LoopbackTransport &a, LoopbackTransport &b )
+  {
+    a.peer_ = &b;
+    b.peer_ = &a;
+  }
+
+  void setTime( unsigned long now_ms ) { now_ms_ = now_ms; }
+
+  unsigned long getTime() const { return now_ms_; }
+
+  //! Simulates a disconnected link. Properties are not delivered while disconnected.
+  void setConnected( bool connected ) { connected_ = connected; }
+
+  void setRSSI( float rssi ) { rssi_ = rssi; }
+
+  CommTransport getTransportType() const override { return type_; }
+
+  void update() override { }
+
+  CommState getCommState() const override
+  {
+    return connected_ && peer_ != nullptr ? CommState::CONNECTED : CommState::DISCONNECTED;
+  }
+
+  float getRSSI() const override { return rssi_; }
+
+  unsigned long getTransmitDurationMs() const override { return transmit_duration_ms_; }
+
+  void setProperty( uint8_t id, const PropertyValue &data ) override
+  {
+    if ( peer_ == nullptr || !connected_ || !peer_->connected_ || id >= NUM_COMM_PROPERTIES )
+      return;
+    Property &property = peer_->properties_[id];
+    property.data = data;
+    property.receive_time_ms = peer_->now_ms_;
+    property.received = true;
+  }
+
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override
+  {
+    data.clear();
+    age_ms = ULONG_MAX;
+    if ( id >= NUM_COMM_PROPERTIES || !properties_[id].received )
+      return;
+    data = properties_[id].data;
+    age_ms = now_ms_ - properties_[id].receive_time_ms;
+  }
+
+private:
+  struct Property {
+    PropertyValue data;
+    unsigned long receive_time_ms = 0;
+    bool received = false;
+  };
+
+  CommTransport type_;
+  unsigned long transmit_duration_ms_;
+  LoopbackTransport *peer_ = nullptr;
+  unsigned long now_ms_ = 0;
+  float rssi_ = 0;
+  bool connected_ = true;
+  Property properties_[NUM_COMM_PROPERTIES];
+};
@@ -4931,6 +4931,7 @@ constexpr uint64_t le64tohost( uint64_t value )
 #define CROSSTALK_SERIAL_ABSTRACTION_HPP
 
 #include <cstdint>
+#include <limits>
 
 namespace crosstalk
 {
@@ -4947,6 +4948,9 @@ public:
   virtual int read( uint8_t *data, size_t length ) = 0;
 
   virtual void write( const uint8_t *data, size_t length ) = 0;
+
+  //! The number of bytes that can be written without blocking. Unlimited if not known.
+  virtual int availableForWrite() const { return std::numeric_limits<int>::max(); }
 };
 } // namespace crosstalk
 
@@ -4978,13 +4982,65 @@ public:
 #ifndef CROSSTALK_CROSSTALKER_HPP
 #define CROSSTALK_CROSSTALKER_HPP
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <optional>
 #include <stddef.h>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
+//! CRC16 backends. All compute CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) and are bit-exact.
+#define CROSSTALK_CRC16_BITWISE 0
+#define CROSSTALK_CRC16_TABLE 1
+#define CROSSTALK_CRC16_SLICE_BY_4 2
+#define CROSSTALK_CRC16_SLICE_BY_8 3
+#define CROSSTALK_CRC16_ESP_ROM 4
+
+// Select the backend by defining CROSSTALK_CRC16_BACKEND, e.g., -DCROSSTALK_CRC16_BACKEND=1
+#ifndef CROSSTALK_CRC16_BACKEND
+  #if defined( ESP_PLATFORM ) && defined( __has_include )
+    #if __has_include( <esp_rom_crc.h> )
+      #define CROSSTALK_CRC16_BACKEND CROSSTALK_CRC16_ESP_ROM
+    #endif
+  #endif
+#endif
+#ifndef CROSSTALK_CRC16_BACKEND
+  #if defined( __linux__ ) || defined( _WIN32 ) || defined( __APPLE__ )
+    #define CROSSTALK_CRC16_BACKEND CROSSTALK_CRC16_SLICE_BY_4
+  #else
+    #define CROSSTALK_CRC16_BACKEND CROSSTALK_CRC16_TABLE
+  #endif
+#endif
+
+#if CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_ESP_ROM
+  #include <esp_rom_crc.h>
+#endif
+
+// The memcpy fast path of the serialization checks the member layout at compile time by comparing
+// one-past-the-end pointers of members in constant expressions. Only GCC is known to evaluate
+// these, hence, the fast path is limited to GCC. Other compilers, e.g., Clang, serialize all types
+// field by field, which produces the same bytes.
+#if defined( __GNUC__ ) && !defined( __clang__ )
+  #define CROSSTALK_MEMCPY_LAYOUT 1
+#else
+  #define CROSSTALK_MEMCPY_LAYOUT 0
+#endif
+
 namespace crosstalk
 {
 
+/*! @brief Attribute to specify the priority class of the object type.
+ * Frames of a higher priority class are sent before queued frames of lower classes when using a
+ * PriorityTxQueue and handled first by Registry::Latest. Types without the attribute have priority 0.
+ */
+struct priority : public refl::attr::usage::type {
+  const uint8_t level;
+
+  explicit constexpr priority( const uint8_t level ) noexcept : level( level ) { }
+};
+
 /*! @brief Attribute to specify the ID of the object type for serialization.
  * This ID is used to identify the type of object being serialized/deserialized.
  * It should be unique for each type.
@@ -5002,6 +5058,16 @@ constexpr int16_t object_id() noexcept
   return std::get<id>( refl::type_descriptor<T>::attributes ).id_value;
 }
 
+template<typename T>
+constexpr uint8_t object_priority() noexcept
+{
+  if constexpr ( refl::descriptor::has_attribute<priority>( refl::reflect<T>() ) ) {
+    return refl::descriptor::get_attribute<priority>( refl::reflect<T>() ).level;
+  } else {
+    return 0;
+  }
+}
+
 enum class ReadResult : uint8_t {
   Success = 0,
   NoObjectAvailable = 1,
@@ -5009,6 +5075,8 @@ enum class ReadResult : uint8_t {
   CrcError = 3,
   ObjectIdMismatch = 4,
   ObjectSizeMismatch = 5, // This is usually when types without clear size are used like int or long
+  UnknownObjectId = 6,    // The object was skipped because its id is not part of the Registry
+  ArenaExhausted = 7,     // The arena was too small for the variable length fields of the object
 };
 
 inline std::string to_string( ReadResult result )
@@ -5026,11 +5094,15 @@ inline std::string to_string( ReadResult result )
     return "ObjectIdMismatch";
   case ReadResult::ObjectSizeMismatch:
     return "ObjectSizeMismatch";
+  case ReadResult::UnknownObjectId:
+    return "UnknownObjectId";
+  case ReadResult::ArenaExhausted:
+    return "ArenaExhausted";
   }
   return "UnknownReadResult";
 }
 
-enum class WriteResult : uint8_t { Success = 0, ObjectTooLarge = 1 };
+enum class WriteResult : uint8_t { Success = 0, ObjectTooLarge = 1, QueueFull = 2 };
 
 inline std::string to_string( WriteResult result )
 {
@@ -5039,11 +5111,117 @@ inline std::string to_string( WriteResult result )
     return "Success";
   case WriteResult::ObjectTooLarge:
     return "ObjectTooLarge";
+  case WriteResult::QueueFull:
+    return "QueueFull";
   }
   return "UnknownWriteResult";
 }
 
-template<int BUFFER_SIZE = 512, int SERIALIZATION_BUFFER_SIZE = BUFFER_SIZE / 2>
+/*!
+ * Caller-provided memory for deserializing variable length fields without heap allocations.
+ * Memory is handed out linearly and released all at once using reset(). No destructors are called,
+ * hence, only trivially destructible types can be allocated.
+ */
+class Arena
+{
+public:
+  Arena( void *buffer, size_t size ) : buffer_( static_cast<uint8_t *>( buffer ) ), size_( size ) { }
+
+  Arena( const Arena & ) = delete;
+  Arena &operator=( const Arena & ) = delete;
+
+  //! Returns nullptr if not enough memory is left. Alignment has to be a power of two.
+  void *allocate( size_t size, size_t alignment )
+  {
+    const uintptr_t address = reinterpret_cast<uintptr_t>( buffer_ ) + used_;
+    const size_t padding = ( alignment - address % alignment ) % alignment;
+    if ( padding > size_ - used_ || size > size_ - used_ - padding )
+      return nullptr;
+    uint8_t *result = buffer_ + used_ + padding;
+    used_ += padding + size;
+    return result;
+  }
+
+  //! Releases all allocations. Views into the arena must not be used afterwards.
+  void reset() { used_ = 0; }
+
+  size_t used() const { return used_; }
+
+  size_t capacity() const { return size_; }
+
+private:
+  uint8_t *buffer_;
+  size_t size_;
+  size_t used_ = 0;
+};
+
+//! Arena with SIZE bytes of inline storage, e.g., on the stack or as a global.
+template<size_t SIZE>
+class StaticArena : public Arena
+{
+public:
+  StaticArena() : Arena( storage_, SIZE ) { }
+
+private:
+  alignas( std::max_align_t ) uint8_t storage_[SIZE];
+};
+
+/*!
+ * Non-owning view of contiguous elements. Serialized like a std::vector.
+ * Deserializing into a Span allocates its elements from the Arena passed to
+ * CrossTalker::readObject, use std::string_view in the same way for strings.
+ */
+template<typename T>
+class Span
+{
+public:
+  Span() = default;
+
+  Span( T *data, size_t size ) : data_( data ), size_( size ) { }
+
+  T *data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  T &operator[]( size_t index ) const { return data_[index]; }
+
+  T *begin() const { return data_; }
+
+  T *end() const { return data_ + size_; }
+
+private:
+  T *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/*!
+ * Default storage for the receive ring buffer of the CrossTalker.
+ *
+ * A storage policy provides SIZE bytes through operator[] and data().
+ * If mirrored is true, the SIZE bytes following the storage map to the same memory, i.e.,
+ * data()[i + SIZE] is data()[i]. Any range of up to SIZE bytes is then contiguous in memory and
+ * the CrossTalker skips all wrap-around handling.
+ */
+template<int SIZE>
+class ArrayRingStorage
+{
+public:
+  static constexpr bool mirrored = false;
+
+  uint8_t &operator[]( int index ) { return buffer_[index]; }
+  const uint8_t &operator[]( int index ) const { return buffer_[index]; }
+
+  uint8_t *data() { return buffer_.data(); }
+  const uint8_t *data() const { return buffer_.data(); }
+
+private:
+  std::array<uint8_t, SIZE> buffer_;
+};
+
+template<int BUFFER_SIZE = 512, int SERIALIZATION_BUFFER_SIZE = BUFFER_SIZE / 2,
+         template<int> class RingStorage = ArrayRingStorage>
 class CrossTalker
 {
 public:
@@ -5070,6 +5248,7 @@ public:
   {
     buffer_index_ = 0;
     buffer_size_ = 0;
+    _resetParser();
   }
 
   //! Read non-object data from the serial buffer.
@@ -5085,6 +5264,13 @@ public:
   template<typename T>
   ReadResult readObject( T &obj );
 
+  /*!
+   * Reads the object from the serial buffer. Variable length fields of type std::string_view and
+   * Span are allocated from the arena instead of the heap. They remain valid until the arena is reset.
+   */
+  template<typename T>
+  ReadResult readObject( T &obj, Arena &arena );
+
   //! Skips the current object in the buffer.
   ReadResult skipObject();
 
@@ -5092,26 +5278,67 @@ public:
   template<typename T>
   WriteResult sendObject( const T &obj );
 
+  //! Send a frame that was serialized using serializeFrame, e.g., from a TxQueue.
+  void sendFrame( const uint8_t *frame, size_t size ) { serial_->write( frame, size ); }
+
+  //! The number of bytes that can be sent without blocking.
+  int availableForWrite() const { return serial_->availableForWrite(); }
+
 private:
   void _processSerialData( int max_to_read = BUFFER_SIZE );
 
   void _processSerialDataUntil( int index );
 
+  //! Wraps an index into the buffer. With mirrored storage, indices below 2 * BUFFER_SIZE are valid.
+  static constexpr int _wrapIndex( int index )
+  {
+    if constexpr ( !RingStorage<BUFFER_SIZE>::mirrored ) {
+      if ( index >= BUFFER_SIZE )
+        return index - BUFFER_SIZE;
+    }
+    return index;
+  }
+
+  uint16_t _readUInt16( int index ) const;
+
+  template<typename T>
+  ReadResult _readObject( T &obj, Arena *arena );
+
   uint16_t _readObjectSize( int start_index ) const;
 
-  int _findNextObjectIndex( int start, int end ) const;
+  //! Inspects bytes that have not been seen by the parser yet. Every byte is inspected only once.
+  void _scanBuffer();
+
+  void _resetParser();
 
   void _markRead( int count );
 
-  std::array<uint8_t, BUFFER_SIZE> buffer_;
+  /*!
+   * State of the incremental frame parser.
+   * While Scanning, the bytes in [buffer_index_, buffer_index_ + scanned_) contain no start marker.
+   * Once a marker is found, scanning stops until the object was consumed and the header is parsed
+   * as soon as enough bytes of it have arrived.
+   */
+  enum class ParserState : uint8_t { Scanning, FoundMarker, HaveId, HaveHeader };
+
+  RingStorage<BUFFER_SIZE> buffer_;
+  //! Only used by sendObject. Received objects are deserialized in place from buffer_.
+  //! Set SERIALIZATION_BUFFER_SIZE to 0 if all frames are sent with sendFrame, e.g., from a TxQueue.
   std::array<uint8_t, SERIALIZATION_BUFFER_SIZE> obj_buffer_;
   std::unique_ptr<SerialAbstraction> serial_;
   int buffer_index_ = 0;
   int buffer_size_ = 0;
+
+  ParserState parser_state_ = ParserState::Scanning;
+  int scanned_ = 0;           //!< Number of bytes after buffer_index_ that were scanned for a marker.
+  bool have_first_ = false;   //!< Whether the last scanned byte was the first start marker byte.
+  int object_index_ = -1;     //!< Offset of the found start marker relative to buffer_index_.
+  int16_t object_id_ = -1;    //!< Id of the found object, valid from HaveId.
+  uint16_t object_size_ = 0;  //!< Serialized size of the found object, valid from HaveHeader.
 };
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_markRead( int count )
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_markRead( int count )
 {
   buffer_size_ -= count;
   buffer_index_ += count;
@@ -5120,11 +5347,70 @@ inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_markRead( int
   if ( buffer_size_ <= 0 ) {
     buffer_size_ = 0;
     buffer_index_ = 0;
+    _resetParser();
+    return;
+  }
+  // Keep the parser offsets relative to the new buffer start
+  if ( parser_state_ == ParserState::Scanning ) {
+    scanned_ -= count;
+    if ( scanned_ <= 0 ) {
+      scanned_ = 0;
+      have_first_ = false;
+    }
+  } else {
+    object_index_ -= count;
+    if ( object_index_ < 0 )
+      _resetParser(); // Object was consumed or dropped, continue scanning after it
   }
+  _scanBuffer();
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_processSerialData( int max_to_read )
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_resetParser()
+{
+  parser_state_ = ParserState::Scanning;
+  scanned_ = 0;
+  have_first_ = false;
+  object_index_ = -1;
+  object_id_ = -1;
+  object_size_ = 0;
+}
+
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_scanBuffer()
+{
+  if ( parser_state_ == ParserState::Scanning ) {
+    int index = _wrapIndex( buffer_index_ + scanned_ );
+    while ( scanned_ < buffer_size_ ) {
+      const uint8_t byte = buffer_[index];
+      ++scanned_;
+      if ( have_first_ && byte == 0x42 ) {
+        object_index_ = scanned_ - 2;
+        parser_state_ = ParserState::FoundMarker;
+        break;
+      }
+      have_first_ = byte == 0x02;
+      index = _wrapIndex( index + 1 );
+    }
+    if ( parser_state_ == ParserState::Scanning )
+      return;
+  }
+  // Parse the header as soon as it is complete. The start marker is followed by 2 bytes id and 2 bytes size.
+  const int object_bytes = buffer_size_ - object_index_;
+  const int start_index = _wrapIndex( buffer_index_ + object_index_ );
+  if ( parser_state_ == ParserState::FoundMarker && object_bytes >= 4 ) {
+    uint16_t tmp = _readUInt16( _wrapIndex( start_index + 2 ) );
+    std::memcpy( &object_id_, &tmp, sizeof( int16_t ) );
+    parser_state_ = ParserState::HaveId;
+  }
+  if ( parser_state_ == ParserState::HaveId && object_bytes >= 6 ) {
+    object_size_ = _readObjectSize( start_index );
+    parser_state_ = ParserState::HaveHeader;
+  }
+}
+
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_processSerialData( int max_to_read )
 {
   int available;
   while ( ( available = serial_->available() ) > 0 ) {
@@ -5133,7 +5419,9 @@ inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_processSerialD
     int index = buffer_index_ + buffer_size_;
     if ( index >= BUFFER_SIZE )
       index -= BUFFER_SIZE;
-    int count = std::min( available, BUFFER_SIZE - index );
+    // Mirrored storage can be written past its end, wrapping to the start
+    int count =
+        std::min( available, RingStorage<BUFFER_SIZE>::mirrored ? BUFFER_SIZE : BUFFER_SIZE - index );
     count = std::min( count, max_to_read );
     count = serial_->read( &buffer_[index], count );
     buffer_size_ += count;
@@ -5142,11 +5430,12 @@ inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_processSerialD
       // Remove the oldest data to ensure buffer_size_ does not exceed BUFFER_SIZE
       _markRead( buffer_size_ - BUFFER_SIZE );
     }
+    _scanBuffer();
   }
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_processSerialDataUntil( int index )
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_processSerialDataUntil( int index )
 {
   int max_to_read = index - buffer_index_;
   if ( max_to_read < 0 )
@@ -5155,9 +5444,9 @@ inline void CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_processSerialD
   _processSerialData( max_to_read );
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
 inline void
-CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::processSerialData( bool overwrite_buffer )
+CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::processSerialData( bool overwrite_buffer )
 {
   // Read one byte less than the buffer size to ensure we don't lose an object start marker
   if ( overwrite_buffer )
@@ -5166,69 +5455,37 @@ CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::processSerialData( bool ove
     _processSerialData( BUFFER_SIZE - buffer_size_ );
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-uint16_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_readObjectSize( int start_index ) const
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline uint16_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_readUInt16( int index ) const
 {
-  int index = start_index + 4; // Size is at index + 4
-  if ( index >= BUFFER_SIZE )
-    index -= BUFFER_SIZE;
-  uint16_t serialized_size = 0;
-  if ( index == BUFFER_SIZE - 1 ) {
-    serialized_size = buffer_[index] | ( static_cast<uint16_t>( buffer_[0] ) << 8 );
-  } else {
-    std::memcpy( &serialized_size, &buffer_[index], 2 );
+  uint16_t value = 0;
+  if constexpr ( !RingStorage<BUFFER_SIZE>::mirrored ) {
+    if ( index == BUFFER_SIZE - 1 ) {
+      value = buffer_[index] | ( static_cast<uint16_t>( buffer_[0] ) << 8 );
+      return value; // Assembled in little-endian order already
+    }
   }
-  return le16tohost( serialized_size );
+  std::memcpy( &value, &buffer_[index], 2 );
+  return le16tohost( value );
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline int CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::_findNextObjectIndex( int start,
-                                                                                      int end ) const
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+uint16_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_readObjectSize( int start_index ) const
 {
-  assert( 0 <= end && end < 2 * BUFFER_SIZE &&
-          "End index must be >= 0 and smaller than 2 * BUFFER_SIZE" );
-  int index = start;
-  if ( end >= BUFFER_SIZE )
-    end -= BUFFER_SIZE; // Wrap around the end index
-  int obj_index = -1;
-  bool have_first = false;
-  do {
-    if ( have_first ) {
-      if ( buffer_[index] == 0x42 )
-        return obj_index;
-      have_first = false;
-    }
-    if ( buffer_[index] == 0x02 ) {
-      obj_index = index;
-      have_first = true;
-    }
-    if ( ++index >= BUFFER_SIZE )
-      index -= BUFFER_SIZE; // Wrap around the buffer index
-  } while ( index != end );
-  return -1; // No object found
+  return _readUInt16( _wrapIndex( start_index + 4 ) ); // Size is at index + 4
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline int CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::available() const
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline int CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::available() const
 {
-  if ( buffer_size_ == 0 )
-    return 0;
-  int obj_index = _findNextObjectIndex( buffer_index_, buffer_index_ + buffer_size_ );
-  if ( obj_index == -1 ) {
-    int last_index = buffer_index_ + buffer_size_ - 1;
-    if ( last_index >= BUFFER_SIZE )
-      last_index -= BUFFER_SIZE; // Wrap around the buffer index
-    // Check if last byte could be a start marker
-    return buffer_[last_index] == 0x02 ? buffer_size_ - 1 : buffer_size_;
-  }
-  int available = obj_index - buffer_index_;
-  if ( available < 0 )
-    available += BUFFER_SIZE; // Wrap around the buffer index
-  return available;
+  if ( parser_state_ != ParserState::Scanning )
+    return object_index_;
+  // Everything was scanned, hold back the last byte if it could be a start marker
+  return have_first_ ? scanned_ - 1 : scanned_;
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::read( uint8_t *data, size_t length )
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::read( uint8_t *data, size_t length )
 {
   int available_bytes = available();
   if ( static_cast<int>( length ) > available_bytes )
@@ -5238,7 +5495,7 @@ inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::read( uint8_t
 
   int start = buffer_index_;
   int end = buffer_index_ + length;
-  if ( end > BUFFER_SIZE ) {
+  if ( !RingStorage<BUFFER_SIZE>::mirrored && end > BUFFER_SIZE ) {
     std::memcpy( data, &buffer_[start], BUFFER_SIZE - start );
     data += ( BUFFER_SIZE - start );
     start = 0;
@@ -5249,8 +5506,8 @@ inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::read( uint8_t
   return length;
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::skip( size_t length )
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::skip( size_t length )
 {
   processSerialData( false );
   int available_bytes = available();
@@ -5260,40 +5517,220 @@ inline size_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::skip( size_t
   return length;
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline bool CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::hasObject() const
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline bool CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::hasObject() const
 {
-  if ( buffer_size_ < 2 || buffer_[buffer_index_] != 0x02 )
-    return false;
-  int second_index = buffer_index_ + 1;
-  if ( second_index >= BUFFER_SIZE )
-    second_index -= BUFFER_SIZE; // Wrap around the buffer index
-  return buffer_[second_index] == 0x42;
+  return parser_state_ != ParserState::Scanning && object_index_ == 0;
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline int16_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::getObjectId() const
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline int16_t CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::getObjectId() const
 {
-  if ( buffer_size_ < 3 || !hasObject() )
+  if ( !hasObject() || parser_state_ == ParserState::FoundMarker )
     return -1;
-  // ID is the third byte in the serialized object
-  int index = buffer_index_ + 2;
-  if ( index >= BUFFER_SIZE )
-    index -= BUFFER_SIZE;
-  uint16_t tmp = 0;
-  if ( index == BUFFER_SIZE - 1 ) {
-    tmp = buffer_[index] | ( static_cast<uint16_t>( buffer_[0] ) << 8 );
+  return object_id_;
+}
+
+namespace util
+{
+
+namespace detail
+{
+template<typename T>
+struct is_std_array : std::false_type {
+};
+
+template<typename T, size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type {
+};
+
+template<typename T>
+struct is_sequence : std::false_type {
+};
+
+template<typename T>
+struct is_sequence<std::vector<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_sequence<Span<T>> : std::true_type {
+};
+} // namespace detail
+
+/*!
+ * The smallest number of bytes a value of type T occupies when serialized.
+ * Used to validate lengths read from the wire against the remaining data before allocating.
+ */
+template<typename T>
+constexpr size_t min_serialized_size();
+
+/*!
+ * Types with a fixed layout have the same serialized size for every value.
+ * These are scalars, std::arrays of fixed layout types and reflected types with only fixed layout
+ * fields. Strings and vectors have a variable layout.
+ */
+template<typename T>
+constexpr bool is_fixed_layout();
+
+//! The serialized size of a fixed layout type.
+template<typename T>
+constexpr size_t fixed_size();
+
+/*!
+ * Whether the serialized representation of T equals its memory representation on little-endian
+ * hosts. This is the case for reflected, trivially copyable types whose reflected fields are
+ * scalars or such types themselves, declared in the same order and without padding in between.
+ * Trailing padding is allowed since only fixed_size<T>() bytes are copied.
+ * Always false for structs if CROSSTALK_MEMCPY_LAYOUT is 0, i.e., with compilers other than GCC.
+ */
+template<typename T>
+constexpr bool is_memcpy_layout();
+
+namespace detail
+{
+template<typename Member>
+constexpr bool is_fixed_layout_member()
+{
+  if constexpr ( refl::descriptor::is_field( Member{} ) ) {
+    return is_fixed_layout<typename Member::value_type>();
   } else {
-    std::memcpy( &tmp, &buffer_[index], 2 );
+    return false;
   }
-  tmp = le16tohost( tmp );
-  int16_t result;
-  std::memcpy( &result, &tmp, sizeof( int16_t ) );
-  return result;
 }
 
-namespace util
+template<typename... Members>
+constexpr bool are_fixed_layout_members( refl::type_list<Members...> )
+{
+  return ( is_fixed_layout_member<Members>() && ... );
+}
+
+template<typename... Members>
+constexpr size_t fixed_members_size( refl::type_list<Members...> )
+{
+  return ( size_t( 0 ) + ... + fixed_size<typename Members::value_type>() );
+}
+
+#if CROSSTALK_MEMCPY_LAYOUT
+//! Used to inspect the memory layout of T at compile time.
+template<typename T>
+inline constexpr T layout_instance{};
+
+//! Whether Next directly follows Member in memory and Member has no trailing padding.
+template<typename T, typename Member, typename Next>
+constexpr bool are_adjacent_members()
+{
+  using value_type = typename Member::value_type;
+  if constexpr ( fixed_size<value_type>() != sizeof( value_type ) ) {
+    return false;
+  } else {
+    return static_cast<const void *>( &( layout_instance<T>.*Member::pointer ) + 1 ) ==
+           static_cast<const void *>( &( layout_instance<T>.*Next::pointer ) );
+  }
+}
+
+template<typename T, typename Member>
+constexpr bool are_contiguous_members( refl::type_list<Member> )
+{
+  return true;
+}
+
+template<typename T, typename Member, typename Next, typename... Rest>
+constexpr bool are_contiguous_members( refl::type_list<Member, Next, Rest...> )
+{
+  return are_adjacent_members<T, Member, Next>() &&
+         are_contiguous_members<T>( refl::type_list<Next, Rest...>{} );
+}
+
+template<typename T, typename First, typename... Rest>
+constexpr bool has_memcpy_members( refl::type_list<First, Rest...> )
+{
+  if constexpr ( !( is_memcpy_layout<typename First::value_type>() && ... &&
+                    is_memcpy_layout<typename Rest::value_type>() ) ) {
+    return false;
+  } else {
+    return static_cast<const void *>( &layout_instance<T> ) ==
+               static_cast<const void *>( &( layout_instance<T>.*First::pointer ) ) &&
+           are_contiguous_members<T>( refl::type_list<First, Rest...>{} );
+  }
+}
+#endif
+} // namespace detail
+
+template<typename T>
+constexpr bool is_fixed_layout()
+{
+  if constexpr ( std::is_scalar_v<T> ) {
+    return true;
+  } else if constexpr ( detail::is_std_array<T>::value ) {
+    return is_fixed_layout<typename T::value_type>();
+  } else if constexpr ( refl::is_reflectable<T>() ) {
+    return detail::are_fixed_layout_members( refl::reflect<T>().members );
+  } else {
+    return false;
+  }
+}
+
+template<typename T>
+constexpr size_t fixed_size()
+{
+  static_assert( is_fixed_layout<T>(), "Type does not have a fixed layout." );
+  if constexpr ( std::is_scalar_v<T> ) {
+    return sizeof( T );
+  } else if constexpr ( detail::is_std_array<T>::value ) {
+    return sizeof( uint16_t ) +
+           std::tuple_size_v<T> * fixed_size<typename T::value_type>(); // Length + items
+  } else {
+    return detail::fixed_members_size( refl::reflect<T>().members );
+  }
+}
+
+namespace detail
+{
+template<typename... Members>
+constexpr size_t min_members_size( refl::type_list<Members...> )
+{
+  return ( size_t( 0 ) + ... + min_serialized_size<typename Members::value_type>() );
+}
+} // namespace detail
+
+template<typename T>
+constexpr size_t min_serialized_size()
+{
+  if constexpr ( std::is_scalar_v<T> ) {
+    return sizeof( T );
+  } else if constexpr ( std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+                        detail::is_sequence<T>::value ) {
+    return sizeof( uint16_t ); // Length
+  } else if constexpr ( detail::is_std_array<T>::value ) {
+    return sizeof( uint16_t ) + std::tuple_size_v<T> * min_serialized_size<typename T::value_type>();
+  } else if constexpr ( refl::is_reflectable<T>() ) {
+    return detail::min_members_size( refl::util::filter( refl::reflect<T>().members, []( auto member ) {
+      return refl::descriptor::is_field( member );
+    } ) );
+  } else {
+    return 0;
+  }
+}
+
+template<typename T>
+constexpr bool is_memcpy_layout()
 {
+  if constexpr ( std::is_scalar_v<T> ) {
+    return true;
+  } else if constexpr ( !refl::is_reflectable<T>() || detail::is_std_array<T>::value ) {
+    return false;
+  } else if constexpr ( !is_fixed_layout<T>() || !std::is_aggregate_v<T> ||
+                        !std::is_trivially_copyable_v<T> || !std::is_standard_layout_v<T> ||
+                        refl::reflect<T>().members.size == 0 ) {
+    return false;
+  } else {
+#if CROSSTALK_MEMCPY_LAYOUT
+    return detail::has_memcpy_members<T>( refl::reflect<T>().members );
+#else
+    return false; // The layout can not be checked, see CROSSTALK_MEMCPY_LAYOUT
+#endif
+  }
+}
 
 template<typename T, std::enable_if_t<std::is_scalar_v<T>, int> = 0>
 constexpr size_t compute_size( const T & )
@@ -5303,20 +5740,25 @@ constexpr size_t compute_size( const T & )
 
 inline size_t compute_size( const std::string &str ) { return sizeof( uint16_t ) + str.length(); }
 
+inline size_t compute_size( std::string_view str ) { return sizeof( uint16_t ) + str.length(); }
+
 template<typename T, size_t N>
 size_t compute_size( const std::array<T, N> &array );
 
 template<typename T>
 size_t compute_size( const std::vector<T> &vec );
 
+template<typename T>
+size_t compute_size( const Span<T> &span );
+
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int> = 0>
 size_t compute_size( const T &obj );
 
 template<typename T, size_t N>
 size_t compute_size( const std::array<T, N> &array )
 {
-  if constexpr ( std::is_scalar_v<T> ) {
-    return sizeof( uint16_t ) + N * sizeof( T );
+  if constexpr ( is_fixed_layout<T>() ) {
+    return sizeof( uint16_t ) + N * fixed_size<T>();
   } else {
     size_t size = sizeof( uint16_t ); // Size of the array length
     for ( const auto &item : array ) { size += compute_size( item ); }
@@ -5327,8 +5769,8 @@ size_t compute_size( const std::array<T, N> &array )
 template<typename T>
 size_t compute_size( const std::vector<T> &vec )
 {
-  if constexpr ( std::is_scalar_v<T> ) {
-    return sizeof( uint16_t ) + vec.size() * sizeof( T );
+  if constexpr ( is_fixed_layout<T>() ) {
+    return sizeof( uint16_t ) + vec.size() * fixed_size<T>();
   } else {
     size_t size = sizeof( uint16_t ); // Size of the vector length
     for ( const auto &item : vec ) { size += compute_size( item ); }
@@ -5336,63 +5778,185 @@ size_t compute_size( const std::vector<T> &vec )
   }
 }
 
+template<typename T>
+size_t compute_size( const Span<T> &span )
+{
+  if constexpr ( is_fixed_layout<std::remove_const_t<T>>() ) {
+    return sizeof( uint16_t ) + span.size() * fixed_size<std::remove_const_t<T>>();
+  } else {
+    size_t size = sizeof( uint16_t ); // Size of the span length
+    for ( const auto &item : span ) { size += compute_size( item ); }
+    return size;
+  }
+}
+
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int>>
 size_t compute_size( const T &obj )
 {
-  const size_t size = refl::util::accumulate(
-      refl::reflect( obj ).members,
-      [&]( size_t size, auto &&member ) { return size + compute_size( member( obj ) ); }, 0 );
-  return size;
+  if constexpr ( is_fixed_layout<T>() ) {
+    return fixed_size<T>();
+  } else {
+    const size_t size = refl::util::accumulate(
+        refl::reflect( obj ).members,
+        [&]( size_t size, auto &&member ) { return size + compute_size( member( obj ) ); }, 0 );
+    return size;
+  }
 }
 
+/*!
+ * Writes serialized data to a buffer with limited capacity.
+ * Writes exceeding the capacity are dropped and mark the writer as overflowed.
+ */
+class BufferWriter
+{
+public:
+  BufferWriter( uint8_t *data, size_t capacity ) : data_( data ), capacity_( capacity ) { }
+
+  void write( const void *data, size_t count )
+  {
+    if ( overflow_ || count > capacity_ - size_ ) {
+      overflow_ = true;
+      return;
+    }
+    std::memcpy( data_ + size_, data, count );
+    size_ += count;
+  }
+
+  //! The number of bytes written so far.
+  size_t size() const { return size_; }
+
+  bool overflow() const { return overflow_; }
+
+private:
+  uint8_t *data_;
+  size_t capacity_;
+  size_t size_ = 0;
+  bool overflow_ = false;
+};
+
 template<typename T, std::enable_if_t<std::is_scalar_v<T>, int> = 0>
-size_t serialize( const T &value, uint8_t *data )
+size_t serialize( BufferWriter &writer, const T &value )
 {
   constexpr size_t size = sizeof( T );
   if constexpr ( size == 1 ) {
-    std::memcpy( data, &value, size );
+    writer.write( &value, size );
   } else if constexpr ( size == 2 ) {
     uint16_t tmp = 0;
     std::memcpy( &tmp, &value, size );
     tmp = hosttole16( tmp );
-    std::memcpy( data, &tmp, size );
+    writer.write( &tmp, size );
   } else if constexpr ( size == 4 ) {
     uint32_t tmp = 0;
     std::memcpy( &tmp, &value, size );
     tmp = hosttole32( tmp );
-    std::memcpy( data, &tmp, size );
+    writer.write( &tmp, size );
   } else if constexpr ( size == 8 ) {
     uint64_t tmp = 0;
     std::memcpy( &tmp, &value, size );
     tmp = hosttole64( tmp );
-    std::memcpy( data, &tmp, size );
+    writer.write( &tmp, size );
   } else {
     static_assert( size <= 8, "Unsupported type size for serialization." );
   }
   return size;
 }
 
+/*!
+ * Reads serialized data from up to two segments.
+ * This allows deserializing objects in place that wrap around the end of a ring buffer.
+ */
+class SegmentedReader
+{
+public:
+  SegmentedReader( const uint8_t *data, size_t length, const uint8_t *second_data = nullptr,
+                   size_t second_length = 0 )
+      : data_( data ), length_( length ), second_data_( second_data ), second_length_( second_length )
+  {
+    _nextSegmentIfEmpty();
+  }
+
+  size_t remaining() const { return length_ + second_length_; }
+
+  //! The arena for std::string_view and Span fields. Deserializing them fails without an arena.
+  Arena *arena() const { return arena_; }
+
+  void setArena( Arena *arena ) { arena_ = arena; }
+
+  //! Allocates from the arena. Returns nullptr and marks the arena as exhausted on failure.
+  void *allocate( size_t size, size_t alignment )
+  {
+    void *result = arena_ == nullptr ? nullptr : arena_->allocate( size, alignment );
+    arena_exhausted_ |= result == nullptr;
+    return result;
+  }
+
+  bool arenaExhausted() const { return arena_exhausted_; }
+
+  //! Copies count bytes to out. Returns false without consuming anything if not enough data is left.
+  bool read( void *out, size_t count )
+  {
+    if ( count > remaining() )
+      return false;
+    auto *dst = static_cast<uint8_t *>( out );
+    if ( count <= length_ ) {
+      std::memcpy( dst, data_, count );
+      data_ += count;
+      length_ -= count;
+    } else {
+      const size_t first = length_;
+      std::memcpy( dst, data_, first );
+      std::memcpy( dst + first, second_data_, count - first );
+      data_ = second_data_ + ( count - first );
+      length_ = second_length_ - ( count - first );
+      second_data_ = nullptr;
+      second_length_ = 0;
+    }
+    _nextSegmentIfEmpty();
+    return true;
+  }
+
+private:
+  void _nextSegmentIfEmpty()
+  {
+    if ( length_ != 0 || second_length_ == 0 )
+      return;
+    data_ = second_data_;
+    length_ = second_length_;
+    second_data_ = nullptr;
+    second_length_ = 0;
+  }
+
+  const uint8_t *data_;
+  size_t length_;
+  const uint8_t *second_data_;
+  size_t second_length_;
+  Arena *arena_ = nullptr;
+  bool arena_exhausted_ = false;
+};
+
 template<typename T, std::enable_if_t<std::is_scalar_v<T>, int> = 0>
-size_t deserialize( const uint8_t *data, int length, T &value )
+size_t deserialize( SegmentedReader &reader, T &value )
 {
-  constexpr int size = sizeof( T );
-  if ( length < size )
-    return 0; // Not enough data to deserialize
+  constexpr size_t size = sizeof( T );
   if constexpr ( size == 1 ) {
-    std::memcpy( &value, data, size );
+    if ( !reader.read( &value, size ) )
+      return 0; // Not enough data to deserialize
   } else if constexpr ( size == 2 ) {
     uint16_t tmp = 0;
-    std::memcpy( &tmp, data, size );
+    if ( !reader.read( &tmp, size ) )
+      return 0;
     tmp = le16tohost( tmp );
     std::memcpy( &value, &tmp, size );
   } else if constexpr ( size == 4 ) {
     uint32_t tmp = 0;
-    std::memcpy( &tmp, data, size );
+    if ( !reader.read( &tmp, size ) )
+      return 0;
     tmp = le32tohost( tmp );
     std::memcpy( &value, &tmp, size );
   } else if constexpr ( size == 8 ) {
     uint64_t tmp = 0;
-    std::memcpy( &tmp, data, size );
+    if ( !reader.read( &tmp, size ) )
+      return 0;
     tmp = le64tohost( tmp );
     std::memcpy( &value, &tmp, size );
   } else {
@@ -5401,107 +5965,199 @@ size_t deserialize( const uint8_t *data, int length, T &value )
   return size;
 }
 
-inline size_t serialize( const std::string &str, uint8_t *data )
+inline size_t serialize( BufferWriter &writer, const std::string &str )
+{
+  size_t offset = serialize( writer, uint16_t( str.length() ) );
+  writer.write( str.data(), str.length() );
+  return offset + str.length();
+}
+
+inline size_t deserialize( SegmentedReader &reader, std::string &str )
+{
+  uint16_t str_length = 0;
+  size_t offset = deserialize( reader, str_length );
+  if ( offset == 0 || reader.remaining() < str_length )
+    return 0; // Not enough data to deserialize
+  str.resize( str_length );
+  reader.read( str.data(), str_length );
+  return offset + str_length;
+}
+
+inline size_t serialize( BufferWriter &writer, std::string_view str )
 {
-  size_t offset = serialize( uint16_t( str.length() ), data );
-  std::memcpy( data + offset, str.data(), str.length() );
+  size_t offset = serialize( writer, uint16_t( str.length() ) );
+  writer.write( str.data(), str.length() );
   return offset + str.length();
 }
 
-inline size_t deserialize( const uint8_t *data, int length, std::string &str )
+inline size_t deserialize( SegmentedReader &reader, std::string_view &str )
 {
   uint16_t str_length = 0;
-  size_t offset = deserialize( data, length, str_length );
-  if ( length < static_cast<int>( offset + str_length ) )
+  size_t offset = deserialize( reader, str_length );
+  if ( offset == 0 || reader.remaining() < str_length )
     return 0; // Not enough data to deserialize
-  str.assign( reinterpret_cast<const char *>( data + offset ), str_length );
+  char *data = nullptr;
+  if ( str_length > 0 ) {
+    data = static_cast<char *>( reader.allocate( str_length, 1 ) );
+    if ( data == nullptr )
+      return 0;
+    reader.read( data, str_length );
+  }
+  str = std::string_view( data, str_length );
   return offset + str_length;
 }
 
 template<typename T>
-size_t serialize( const std::vector<T> &vec, uint8_t *data );
+size_t serialize( BufferWriter &writer, const std::vector<T> &vec );
 
 template<typename T>
-size_t deserialize( const uint8_t *data, int length, std::vector<T> &vec );
+size_t deserialize( SegmentedReader &reader, std::vector<T> &vec );
+
+template<typename T>
+size_t serialize( BufferWriter &writer, const Span<T> &span );
+
+template<typename T>
+size_t deserialize( SegmentedReader &reader, Span<T> &span );
 
 template<typename T, size_t N>
-size_t serialize( const std::array<T, N> &array, uint8_t *data );
+size_t serialize( BufferWriter &writer, const std::array<T, N> &array );
 
 template<typename T, size_t N>
-size_t deserialize( const uint8_t *data, int length, std::array<T, N> &array );
+size_t deserialize( SegmentedReader &reader, std::array<T, N> &array );
 
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int> = 0>
-size_t serialize( const T &obj, uint8_t *data );
+size_t serialize( BufferWriter &writer, const T &obj );
 
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int> = 0>
-constexpr size_t deserialize( const uint8_t *data, int length, T &obj );
+size_t deserialize( SegmentedReader &reader, T &obj );
 
 template<typename T>
-size_t serialize( const std::vector<T> &vec, uint8_t *data )
+size_t serialize( BufferWriter &writer, const std::vector<T> &vec )
 {
-  size_t offset = serialize( uint16_t( vec.size() ), data );
-  for ( const auto &item : vec ) { offset += serialize( item, data + offset ); }
+  size_t offset = serialize( writer, uint16_t( vec.size() ) );
+  for ( const auto &item : vec ) { offset += serialize( writer, item ); }
   return offset;
 }
 
 template<typename T>
-size_t deserialize( const uint8_t *data, int length, std::vector<T> &vec )
+size_t deserialize( SegmentedReader &reader, std::vector<T> &vec )
 {
   uint16_t item_count = 0;
-  size_t offset = deserialize( data, length, item_count );
+  size_t offset = deserialize( reader, item_count );
+  // Validate the untrusted count before allocating
+  if ( offset == 0 || item_count * min_serialized_size<T>() > reader.remaining() )
+    return 0;
   vec.resize( item_count );
+  for ( size_t i = 0; i < item_count; ++i ) { offset += deserialize( reader, vec[i] ); }
+  return offset;
+}
+
+template<typename T>
+size_t serialize( BufferWriter &writer, const Span<T> &span )
+{
+  size_t offset = serialize( writer, uint16_t( span.size() ) );
+  for ( const auto &item : span ) { offset += serialize( writer, item ); }
+  return offset;
+}
+
+template<typename T>
+size_t deserialize( SegmentedReader &reader, Span<T> &span )
+{
+  using Item = std::remove_const_t<T>;
+  static_assert( std::is_trivially_destructible_v<Item>,
+                 "Span items are allocated from an arena and must be trivially destructible." );
+  uint16_t item_count = 0;
+  size_t offset = deserialize( reader, item_count );
+  // Validate the untrusted count before allocating
+  if ( offset == 0 || item_count * min_serialized_size<Item>() > reader.remaining() )
+    return 0;
+  Item *items = nullptr;
+  if ( item_count > 0 ) {
+    items = static_cast<Item *>( reader.allocate( item_count * sizeof( Item ), alignof( Item ) ) );
+    if ( items == nullptr )
+      return 0;
+  }
   for ( size_t i = 0; i < item_count; ++i ) {
-    offset += deserialize( data + offset, length - offset, vec[i] );
+    new ( items + i ) Item();
+    offset += deserialize( reader, items[i] );
   }
+  span = Span<T>( items, item_count );
   return offset;
 }
 
 template<typename T, size_t N>
-size_t serialize( const std::array<T, N> &array, uint8_t *data )
+size_t serialize( BufferWriter &writer, const std::array<T, N> &array )
 {
-  size_t offset = serialize( uint16_t( N ), data );
-  for ( const auto &item : array ) { offset += serialize( item, data + offset ); }
+  size_t offset = serialize( writer, uint16_t( N ) );
+  for ( const auto &item : array ) { offset += serialize( writer, item ); }
   return offset;
 }
 
 template<typename T, size_t N>
-size_t deserialize( const uint8_t *data, int length, std::array<T, N> &array )
+size_t deserialize( SegmentedReader &reader, std::array<T, N> &array )
 {
   uint16_t item_count = 0;
-  size_t offset = deserialize( data, length, item_count );
-  assert( item_count == N );
-  for ( size_t i = 0; i < std::min<size_t>( N, item_count ); ++i ) {
-    offset += deserialize( data + offset, length - offset, array[i] );
-  }
+  size_t offset = deserialize( reader, item_count );
+  if ( offset == 0 || item_count != N )
+    return 0; // Size mismatch, the object is reported as ObjectSizeMismatch
+  for ( size_t i = 0; i < N; ++i ) { offset += deserialize( reader, array[i] ); }
   return offset;
 }
 
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int>>
-size_t serialize( const T &obj, uint8_t *data )
+size_t serialize( BufferWriter &writer, const T &obj )
 {
   static_assert( refl::is_reflectable<T>() && "Type must be reflectable." );
+  if constexpr ( is_memcpy_layout<T>() ) {
+    if ( is_little_endian ) {
+      writer.write( &obj, fixed_size<T>() );
+      return fixed_size<T>();
+    }
+  }
   size_t offset = 0;
-  refl::util::for_each( refl::reflect( obj ).members, [&]( auto &&member ) {
-    offset += serialize( member( obj ), data + offset );
-  } );
+  refl::util::for_each( refl::reflect( obj ).members,
+                        [&]( auto &&member ) { offset += serialize( writer, member( obj ) ); } );
   return offset;
 }
 
+//! Serializes the value to data which has to be large enough. Returns the number of written bytes.
+template<typename T>
+size_t serialize( const T &value, uint8_t *data )
+{
+  BufferWriter writer( data, SIZE_MAX );
+  return serialize( writer, value );
+}
+
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int>>
-constexpr size_t deserialize( const uint8_t *data, int length, T &obj )
+size_t deserialize( SegmentedReader &reader, T &obj )
 {
   static_assert( refl::is_reflectable<T>() && "Type must be reflectable." );
+  if constexpr ( is_memcpy_layout<T>() ) {
+    if ( is_little_endian )
+      return reader.read( &obj, fixed_size<T>() ) ? fixed_size<T>() : 0;
+  }
   size_t offset = 0;
-  refl::util::for_each( refl::reflect( obj ).members, [&]( auto &&member ) {
-    offset += deserialize( data + offset, length - offset, member( obj ) );
-  } );
+  refl::util::for_each( refl::reflect( obj ).members,
+                        [&]( auto &&member ) { offset += deserialize( reader, member( obj ) ); } );
   return offset;
 }
 
-inline uint16_t compute_crc16( const uint8_t *data, size_t length )
+//! Deserializes the value from contiguous data. Returns the number of consumed bytes.
+template<typename T>
+size_t deserialize( const uint8_t *data, int length, T &value )
+{
+  SegmentedReader reader( data, length < 0 ? 0 : static_cast<size_t>( length ) );
+  return deserialize( reader, value );
+}
+
+namespace crc16
+{
+constexpr uint16_t initial_value = 0xFFFF;
+
+//! Reference implementation processing one byte at a time without lookup tables.
+inline uint16_t update_bitwise( uint16_t crc, const uint8_t *data, size_t length )
 {
   uint8_t x;
-  uint16_t crc = 0xFFFF;
   for ( size_t i = 0; i < length; ++i ) {
     x = ( crc >> 8 ) ^ data[i];
     x ^= ( x >> 4 );
@@ -5509,11 +6165,114 @@ inline uint16_t compute_crc16( const uint8_t *data, size_t length )
   }
   return crc;
 }
+
+//! Generates the tables for slicing. Table k contains the CRC of a byte followed by k zero bytes.
+template<size_t SLICES>
+constexpr std::array<std::array<uint16_t, 256>, SLICES> make_tables()
+{
+  std::array<std::array<uint16_t, 256>, SLICES> tables = {};
+  for ( uint16_t i = 0; i < 256; ++i ) {
+    uint16_t crc = i << 8;
+    for ( int bit = 0; bit < 8; ++bit ) {
+      crc = ( crc & 0x8000 ) ? static_cast<uint16_t>( ( crc << 1 ) ^ 0x1021 )
+                             : static_cast<uint16_t>( crc << 1 );
+    }
+    tables[0][i] = crc;
+  }
+  for ( size_t k = 1; k < SLICES; ++k ) {
+    for ( size_t i = 0; i < 256; ++i ) {
+      const uint16_t prev = tables[k - 1][i];
+      tables[k][i] = static_cast<uint16_t>( prev << 8 ) ^ tables[0][prev >> 8];
+    }
+  }
+  return tables;
+}
+
+#if CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_TABLE ||                                          \
+    CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_4 ||                                       \
+    CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_8
+inline constexpr auto tables =
+    make_tables<CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_8   ? 8
+                : CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_4 ? 4
+                                                                        : 1>();
+
+inline uint16_t update_table( uint16_t crc, const uint8_t *data, size_t length )
+{
+  for ( size_t i = 0; i < length; ++i ) {
+    crc = static_cast<uint16_t>( crc << 8 ) ^ tables[0][( crc >> 8 ) ^ data[i]];
+  }
+  return crc;
+}
+
+//! Processes SLICES bytes per iteration. Only the first two bytes of a slice depend on the CRC.
+template<size_t SLICES>
+inline uint16_t update_sliced( uint16_t crc, const uint8_t *data, size_t length )
+{
+  static_assert( SLICES >= 2 && SLICES <= tables.size(), "Not enough tables for slicing." );
+  while ( length >= SLICES ) {
+    uint16_t result = tables[SLICES - 1][data[0] ^ ( crc >> 8 )] ^
+                      tables[SLICES - 2][data[1] ^ ( crc & 0xFF )];
+    for ( size_t k = 2; k < SLICES; ++k ) { result ^= tables[SLICES - 1 - k][data[k]]; }
+    crc = result;
+    data += SLICES;
+    length -= SLICES;
+  }
+  return update_table( crc, data, length );
+}
+#endif
+
+#if CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_ESP_ROM
+inline uint16_t update_esp_rom( uint16_t crc, const uint8_t *data, size_t length )
+{
+  // The ROM routine inverts the CRC before and after, see esp_rom_crc.h for CRC-16/CCITT-FALSE
+  return ~esp_rom_crc16_be( static_cast<uint16_t>( ~crc ), data, length );
+}
+#endif
+
+//! Continues the CRC computation over the next chunk of data using the selected backend.
+inline uint16_t update( uint16_t crc, const uint8_t *data, size_t length )
+{
+#if CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_BITWISE
+  return update_bitwise( crc, data, length );
+#elif CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_TABLE
+  return update_table( crc, data, length );
+#elif CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_4
+  return update_sliced<4>( crc, data, length );
+#elif CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_8
+  return update_sliced<8>( crc, data, length );
+#elif CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_ESP_ROM
+  return update_esp_rom( crc, data, length );
+#else
+  #error "Unknown CROSSTALK_CRC16_BACKEND"
+#endif
+}
+} // namespace crc16
+
+inline uint16_t compute_crc16( const uint8_t *data, size_t length )
+{
+  return crc16::update( crc16::initial_value, data, length );
+}
 } // namespace util
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+template<typename T>
+inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::readObject( T &obj )
+{
+  return _readObject( obj, nullptr );
+}
+
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
 template<typename T>
-inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::readObject( T &obj )
+inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::readObject( T &obj,
+                                                                                               Arena &arena )
+{
+  return _readObject( obj, &arena );
+}
+
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+template<typename T>
+inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::_readObject( T &obj,
+                                                                                                Arena *arena )
 {
   static_assert( refl::is_reflectable<T>(), "Type must be reflectable." );
   constexpr auto type_info = refl::reflect<T>();
@@ -5524,51 +6283,58 @@ inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::readObjec
   }
   // Read as much data as available
   _processSerialDataUntil( buffer_index_ );
-  if ( buffer_size_ < 6 ) {
+  if ( parser_state_ != ParserState::HaveHeader ) {
     return ReadResult::NotEnoughData; // Not enough data to read metadata
   }
-  if ( getObjectId() != id )
+  if ( object_id_ != id )
     return ReadResult::ObjectIdMismatch;
-  uint16_t serialized_size = _readObjectSize( buffer_index_ );
+  const uint16_t serialized_size = object_size_;
   if ( serialized_size + 8 > buffer_size_ ) {
     return ReadResult::NotEnoughData; // Not enough data to deserialize the object
   }
-  const uint8_t *data = &buffer_[buffer_index_];
-  if ( buffer_index_ + serialized_size + 8 > BUFFER_SIZE ) {
-    // If data wraps around circular buffer, copy it to read buffer for continuous access
-    std::memcpy( obj_buffer_.data(), &buffer_[buffer_index_], BUFFER_SIZE - buffer_index_ );
-    std::memcpy( obj_buffer_.data() + BUFFER_SIZE - buffer_index_, &buffer_[0],
-                 buffer_index_ + 8 + serialized_size - BUFFER_SIZE );
-    data = obj_buffer_.data();
-  }
-
-  // Check CRC
-  uint16_t crc = 0;
-  std::memcpy( &crc, data + serialized_size + 6, 2 );
-  crc = le16tohost( crc );
-  uint16_t computed_crc = util::compute_crc16( data, 6 + serialized_size );
+  // The object may wrap around the end of the circular buffer. Header and payload are therefore
+  // processed as up to two segments in place: [buffer_index_, BUFFER_SIZE) and [0, rest).
+  // With mirrored storage, the first segment always covers the whole object.
+  constexpr bool mirrored = RingStorage<BUFFER_SIZE>::mirrored;
+  const int content_size = 6 + serialized_size;
+  const int first_size = mirrored ? content_size : std::min( content_size, BUFFER_SIZE - buffer_index_ );
+  uint16_t computed_crc =
+      util::crc16::update( util::crc16::initial_value, &buffer_[buffer_index_], first_size );
+  if ( !mirrored )
+    computed_crc = util::crc16::update( computed_crc, buffer_.data(), content_size - first_size );
+  const uint16_t crc = _readUInt16( _wrapIndex( buffer_index_ + content_size ) );
   size_t consumed = 0;
+  bool arena_exhausted = false;
   if ( crc == computed_crc ) {
-    consumed = util::deserialize<T>( data + 6, serialized_size, obj );
+    const int payload_index = _wrapIndex( buffer_index_ + 6 );
+    const int payload_first_size =
+        mirrored ? serialized_size : std::min<int>( serialized_size, BUFFER_SIZE - payload_index );
+    util::SegmentedReader reader( &buffer_[payload_index], payload_first_size, buffer_.data(),
+                                  serialized_size - payload_first_size );
+    reader.setArena( arena );
+    consumed = util::deserialize<T>( reader, obj );
+    arena_exhausted = reader.arenaExhausted();
   }
   // Whether or not the CRC is valid, we need to update the buffer indices
   _markRead( 8 + serialized_size );
   if ( crc != computed_crc )
     return ReadResult::CrcError;
+  if ( arena_exhausted )
+    return ReadResult::ArenaExhausted;
   return serialized_size != consumed ? ReadResult::ObjectSizeMismatch : ReadResult::Success;
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
-inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::skipObject()
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::skipObject()
 {
   if ( !hasObject() ) {
     return ReadResult::NoObjectAvailable;
   }
   _processSerialDataUntil( buffer_index_ );
-  if ( buffer_size_ < 6 ) {
+  if ( parser_state_ != ParserState::HaveHeader ) {
     return ReadResult::NotEnoughData; // Not enough data to read metadata
   }
-  uint16_t serialized_size = _readObjectSize( buffer_index_ );
+  const uint16_t serialized_size = object_size_;
   if ( serialized_size + 8 > buffer_size_ ) {
     return ReadResult::NotEnoughData; // Not enough data to skip the object
   }
@@ -5576,38 +6342,455 @@ inline ReadResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::skipObjec
   return ReadResult::Success;
 }
 
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
 template<typename T>
-inline WriteResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE>::sendObject( const T &obj )
+WriteResult serializeFrame( const T &obj, uint8_t *buffer, size_t capacity, size_t &size )
 {
   static_assert( refl::is_reflectable<T>(), "Type must be reflectable." );
   constexpr auto type_info = refl::reflect<T>();
   constexpr auto id = std::get<crosstalk::id>( type_info.attributes ).id_value;
   static_assert( id >= 0, "Object ID must be greater or equal to 0. Negative ids are reserved." );
   // 2 bytes start, 2 byte id, 2 bytes length, 2 bytes crc
-  size_t size = 8 + util::compute_size( obj );
-  if ( size > SERIALIZATION_BUFFER_SIZE ) {
+  size = 0;
+  if ( capacity < 8 )
+    return WriteResult::ObjectTooLarge;
+  if constexpr ( util::is_fixed_layout<T>() ) {
+    if ( util::fixed_size<T>() + 8 > capacity )
+      return WriteResult::ObjectTooLarge;
+  }
+  // Serialize in a single pass and write the size afterwards
+  util::BufferWriter writer( buffer + 6, capacity - 8 );
+  util::serialize( writer, obj );
+  if ( writer.overflow() ) {
     return WriteResult::ObjectTooLarge;
   }
-  obj_buffer_[0] = 0x02;
-  obj_buffer_[1] = 0x42;
-  // Write the ID in little-endian format
+  const size_t serialized_size = writer.size();
+  buffer[0] = 0x02;
+  buffer[1] = 0x42;
+  // Write the ID and size in little-endian format
   uint16_t uid;
   std::memcpy( &uid, &id, sizeof( uint16_t ) );
   uid = hosttole16( uid );
-  *reinterpret_cast<uint16_t *>( obj_buffer_.data() + 2 ) = uid;
-  // Write the serialized object
-  size_t serialized_size = util::serialize<T>( obj, obj_buffer_.data() + 6 );
-  // Write the size of the serialized object
-  *reinterpret_cast<uint16_t *>( obj_buffer_.data() + 4 ) =
-      hosttole16( static_cast<uint16_t>( serialized_size ) );
-  assert( serialized_size == size - 8 && "Serialized size does not match expected size" );
+  std::memcpy( buffer + 2, &uid, sizeof( uint16_t ) );
+  const uint16_t le_size = hosttole16( static_cast<uint16_t>( serialized_size ) );
+  std::memcpy( buffer + 4, &le_size, sizeof( uint16_t ) );
   // Write the CRC
-  *reinterpret_cast<uint16_t *>( obj_buffer_.data() + 6 + serialized_size ) =
-      hosttole16( util::compute_crc16( obj_buffer_.data(), 6 + serialized_size ) );
+  const uint16_t crc = hosttole16( util::compute_crc16( buffer, 6 + serialized_size ) );
+  std::memcpy( buffer + 6 + serialized_size, &crc, sizeof( uint16_t ) );
+  size = 8 + serialized_size;
+  return WriteResult::Success;
+}
+
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
+template<typename T>
+inline WriteResult CrossTalker<BUFFER_SIZE, SERIALIZATION_BUFFER_SIZE, RingStorage>::sendObject( const T &obj )
+{
+  static_assert( SERIALIZATION_BUFFER_SIZE >= 8,
+                 "Serialization buffer too small. A size of 0 only supports sendFrame." );
+  size_t size = 0;
+  const WriteResult result =
+      serializeFrame( obj, obj_buffer_.data(), SERIALIZATION_BUFFER_SIZE, size );
+  if ( result != WriteResult::Success )
+    return result;
   serial_->write( obj_buffer_.data(), size );
   return WriteResult::Success;
 }
+
+/*!
+ * Bounded multi-producer single-consumer queue of serialized frames.
+ *
+ * Producers claim a slot with a single compare-exchange and serialize the object directly into it,
+ * hence, they never block each other. A single consumer, e.g., the thread that owns the
+ * CrossTalker, drains the frames in order and writes them using CrossTalker::sendFrame.
+ * A slot is only handed to the consumer once its producer has finished serializing it.
+ *
+ * @tparam SLOT_SIZE The maximum frame size including start marker, id, size and CRC.
+ * @tparam SLOT_COUNT The number of frames that can be queued. Has to be a power of two.
+ */
+template<size_t SLOT_SIZE, size_t SLOT_COUNT>
+class TxQueue
+{
+  static_assert( SLOT_SIZE >= 8 && SLOT_SIZE <= 0xFFFF, "SLOT_SIZE must be between 8 and 65535." );
+  static_assert( SLOT_COUNT >= 2 && ( SLOT_COUNT & ( SLOT_COUNT - 1 ) ) == 0,
+                 "SLOT_COUNT must be a power of two." );
+
+public:
+  TxQueue()
+  {
+    for ( size_t i = 0; i < SLOT_COUNT; ++i ) slots_[i].sequence.store( i, std::memory_order_relaxed );
+  }
+
+  TxQueue( const TxQueue & ) = delete;
+  TxQueue &operator=( const TxQueue & ) = delete;
+
+  /*!
+   * Serializes the object into a free slot. Thread-safe and lock-free.
+   * @return QueueFull if no slot is free or ObjectTooLarge if the frame does not fit into a slot.
+   */
+  template<typename T>
+  WriteResult push( const T &obj )
+  {
+    if constexpr ( util::is_fixed_layout<T>() ) {
+      static_assert( util::fixed_size<T>() + 8 <= SLOT_SIZE, "Object does not fit into a slot." );
+    }
+    size_t position = tail_.load( std::memory_order_relaxed );
+    Slot *slot;
+    while ( true ) {
+      slot = &slots_[position & ( SLOT_COUNT - 1 )];
+      const size_t sequence = slot->sequence.load( std::memory_order_acquire );
+      const auto diff = static_cast<std::ptrdiff_t>( sequence - position );
+      if ( diff == 0 ) {
+        if ( tail_.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+          break;
+      } else if ( diff < 0 ) {
+        return WriteResult::QueueFull; // The consumer has not freed this slot yet
+      } else {
+        position = tail_.load( std::memory_order_relaxed );
+      }
+    }
+    size_t size = 0;
+    const WriteResult result = serializeFrame( obj, slot->data, SLOT_SIZE, size );
+    // The slot is published even if serialization failed to not stall the consumer
+    slot->size = static_cast<uint16_t>( result == WriteResult::Success ? size : 0 );
+    slot->sequence.store( position + 1, std::memory_order_release );
+    return result;
+  }
+
+  /*!
+   * Passes all published frames in order to consumer( const uint8_t *frame, size_t size ).
+   * Must only be called from a single thread at a time.
+   * @return The number of frames passed to the consumer.
+   */
+  template<typename Consumer>
+  size_t drain( Consumer &&consumer )
+  {
+    size_t count = 0;
+    const uint8_t *frame;
+    size_t size;
+    while ( peek( frame, size ) ) {
+      consumer( frame, size );
+      pop();
+      ++count;
+    }
+    return count;
+  }
+
+  /*!
+   * Gets the oldest published frame without removing it. Consumer only.
+   * @return False if no frame is available or the producer of the oldest frame is not done yet.
+   */
+  bool peek( const uint8_t *&frame, size_t &size )
+  {
+    while ( true ) {
+      Slot &slot = slots_[head_ & ( SLOT_COUNT - 1 )];
+      if ( slot.sequence.load( std::memory_order_acquire ) != head_ + 1 )
+        return false; // Empty or the producer is still serializing
+      if ( slot.size > 0 ) {
+        frame = slot.data;
+        size = slot.size;
+        return true;
+      }
+      pop(); // Serialization failed, nothing to send
+    }
+  }
+
+  //! Removes the frame returned by peek. Consumer only.
+  void pop()
+  {
+    slots_[head_ & ( SLOT_COUNT - 1 )].sequence.store( head_ + SLOT_COUNT, std::memory_order_release );
+    ++head_;
+  }
+
+  //! Whether no published frames are queued. Only meaningful for the consumer.
+  bool empty() const
+  {
+    return slots_[head_ & ( SLOT_COUNT - 1 )].sequence.load( std::memory_order_acquire ) != head_ + 1;
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    uint16_t size = 0;
+    uint8_t data[SLOT_SIZE];
+  };
+
+  Slot slots_[SLOT_COUNT];
+  // Separate cache lines to avoid false sharing between the producers and the consumer
+  alignas( 64 ) std::atomic<size_t> tail_{ 0 }; //!< Next position to claim by producers.
+  alignas( 64 ) size_t head_ = 0;               //!< Next position to drain by the consumer.
+};
+
+/*!
+ * One TxQueue per priority class as declared with the crosstalk::priority attribute.
+ * Frames are sent highest priority first, hence, a frame of a higher class overtakes all queued
+ * frames of lower classes. Frames that were already handed to the serial port can not be overtaken,
+ * therefore, flush only writes frames that fit into the TX buffer of the port and frames below the
+ * highest priority leave a reserve of the TX buffer free. The reserve bounds the bytes a frame of
+ * the highest priority waits behind to the size of the TX buffer minus the reserve.
+ *
+ * @tparam LEVELS The number of priority classes. Priorities have to be smaller than this.
+ */
+template<size_t SLOT_SIZE, size_t SLOT_COUNT, uint8_t LEVELS = 2>
+class PriorityTxQueue
+{
+  static_assert( LEVELS > 0, "At least one priority level is required." );
+
+public:
+  /*!
+   * @param reserved_bytes Bytes of the TX buffer that frames below the highest priority leave free.
+   *   The TX buffer minus the reserve has to hold the largest of these frames, otherwise it is
+   *   never sent.
+   */
+  explicit PriorityTxQueue( int reserved_bytes = 0 ) : reserved_bytes_( reserved_bytes ) { }
+
+  template<typename T>
+  WriteResult push( const T &obj )
+  {
+    static_assert( object_priority<T>() < LEVELS, "Object priority exceeds the number of levels." );
+    return queues_[object_priority<T>()].push( obj );
+  }
+
+  /*!
+   * Writes queued frames to the talker, highest priority first.
+   * Stops at the first frame that does not fit into the TX buffer of the serial port, or into the
+   * TX buffer minus the reserve for frames below the highest priority, to not block and to keep
+   * the buffer free for frames of higher priority that are queued later.
+   * Consumer only.
+   * @return The number of frames written.
+   */
+  template<typename Talker>
+  size_t flush( Talker &talker )
+  {
+    size_t count = 0;
+    const uint8_t *frame;
+    size_t size;
+    while ( true ) {
+      int level = LEVELS - 1;
+      while ( level >= 0 && !queues_[level].peek( frame, size ) ) --level;
+      if ( level < 0 )
+        return count;
+      const int reserve = level == LEVELS - 1 ? 0 : reserved_bytes_;
+      if ( static_cast<int>( size ) + reserve > talker.availableForWrite() )
+        return count;
+      talker.sendFrame( frame, size );
+      queues_[level].pop();
+      ++count;
+    }
+  }
+
+  //! Whether no frames are queued. Consumer only.
+  bool empty() const
+  {
+    for ( const auto &queue : queues_ ) {
+      if ( !queue.empty() )
+        return false;
+    }
+    return true;
+  }
+
+private:
+  TxQueue<SLOT_SIZE, SLOT_COUNT> queues_[LEVELS];
+  int reserved_bytes_;
+};
+
+//! Combines multiple callables, e.g., lambdas, into one overloaded handler.
+template<typename... Fs>
+struct overloaded : Fs... {
+  using Fs::operator()...;
+};
+
+template<typename... Fs>
+overloaded( Fs... ) -> overloaded<Fs...>;
+
+/*!
+ * A set of object types exchanged over a CrossTalker connection.
+ * Checks at compile time that all ids are unique and provides the size of the largest frame to
+ * size the buffers as well as a dispatcher that reads the available object into its type.
+ *
+ * Example:
+ * @code
+ * using Objects = crosstalk::Registry<EStopState, SetEnabledCommand>;
+ * Objects::dispatch( talker, crosstalk::overloaded{ []( const EStopState &state ) { ... },
+ *                                                   []( const SetEnabledCommand &cmd ) { ... } } );
+ * @endcode
+ */
+template<typename... Ts>
+class Registry
+{
+  static constexpr std::array<int16_t, sizeof...( Ts )> ids_ = { object_id<Ts>()... };
+
+  static constexpr bool _hasUniqueIds()
+  {
+    for ( size_t i = 0; i < ids_.size(); ++i ) {
+      for ( size_t j = i + 1; j < ids_.size(); ++j ) {
+        if ( ids_[i] == ids_[j] )
+          return false;
+      }
+    }
+    return true;
+  }
+
+  static constexpr int16_t _maxId()
+  {
+    int16_t result = -1;
+    for ( int16_t id : ids_ ) result = id > result ? id : result;
+    return result;
+  }
+
+  // Ids up to this value are looked up in a table, otherwise the ids are compared one by one.
+  static constexpr int16_t max_table_id_ = 255;
+  static constexpr int table_size_ = _maxId() <= max_table_id_ ? _maxId() + 1 : 0;
+
+  static constexpr std::array<uint8_t, table_size_> _makeIndexTable()
+  {
+    std::array<uint8_t, table_size_> table = {};
+    for ( auto &index : table ) index = sizeof...( Ts );
+    for ( size_t i = 0; i < ids_.size(); ++i ) {
+      if ( ids_[i] < table_size_ )
+        table[ids_[i]] = static_cast<uint8_t>( i );
+    }
+    return table;
+  }
+
+  static constexpr std::array<uint8_t, table_size_> index_table_ = _makeIndexTable();
+
+  template<typename Talker, typename Handler, typename T>
+  static ReadResult _readAndHandle( Talker &talker, Handler &handler )
+  {
+    T obj;
+    const ReadResult result = talker.readObject( obj );
+    if ( result == ReadResult::Success )
+      handler( static_cast<const T &>( obj ) );
+    return result;
+  }
+
+public:
+  static_assert( sizeof...( Ts ) > 0, "Registry must contain at least one type." );
+  static_assert( sizeof...( Ts ) < 255, "Registry supports at most 254 types." );
+  static_assert( ( refl::is_reflectable<Ts>() && ... ), "All types must be reflectable." );
+  static_assert( ( ( object_id<Ts>() >= 0 ) && ... ),
+                 "Object IDs must be greater or equal to 0. Negative ids are reserved." );
+  static_assert( _hasUniqueIds(), "Object IDs in a Registry must be unique." );
+
+  static constexpr size_t size = sizeof...( Ts );
+
+  //! Whether all types have a fixed serialized size. Required for max_object_size().
+  static constexpr bool fixed_layout = ( util::is_fixed_layout<Ts>() && ... );
+
+  //! Returns the index of the type with the given id or size if the id is not registered.
+  static constexpr size_t indexOf( int16_t id )
+  {
+    if constexpr ( table_size_ > 0 ) {
+      return id >= 0 && id < table_size_ ? index_table_[id] : size;
+    } else {
+      for ( size_t i = 0; i < ids_.size(); ++i ) {
+        if ( ids_[i] == id )
+          return i;
+      }
+      return size;
+    }
+  }
+
+  static constexpr bool contains( int16_t id ) { return indexOf( id ) != size; }
+
+  template<typename T>
+  static constexpr bool contains()
+  {
+    return ( std::is_same_v<T, Ts> || ... );
+  }
+
+  //! The largest serialized size of all types.
+  static constexpr size_t max_object_size()
+  {
+    static_assert( fixed_layout, "The size is only known if all types have a fixed layout." );
+    size_t result = 0;
+    ( ( result = util::fixed_size<Ts>() > result ? util::fixed_size<Ts>() : result ), ... );
+    return result;
+  }
+
+  //! The largest frame size including start marker, id, size and CRC.
+  static constexpr size_t max_frame_size() { return max_object_size() + 8; }
+
+  /*!
+   * Reads the available object of the talker and calls the handler with it as const reference.
+   * The handler has to be callable with each of the registered types.
+   * Objects with ids that are not registered are skipped and reported to on_unknown with their id.
+   * @return The result of reading the object or UnknownObjectId if the object was skipped.
+   */
+  template<typename Talker, typename Handler, typename UnknownHandler>
+  static ReadResult dispatch( Talker &talker, Handler &&handler, UnknownHandler &&on_unknown )
+  {
+    if ( !talker.hasObject() )
+      return ReadResult::NoObjectAvailable;
+    const int16_t id = talker.getObjectId();
+    if ( id < 0 )
+      return ReadResult::NotEnoughData; // Header not complete
+    using Reader = ReadResult ( * )( Talker &, std::remove_reference_t<Handler> & );
+    static constexpr Reader readers[] = {
+        &_readAndHandle<Talker, std::remove_reference_t<Handler>, Ts>... };
+    const size_t index = indexOf( id );
+    if ( index == size ) {
+      const ReadResult result = talker.skipObject();
+      if ( result != ReadResult::Success )
+        return result;
+      on_unknown( id );
+      return ReadResult::UnknownObjectId;
+    }
+    return readers[index]( talker, handler );
+  }
+
+  template<typename Talker, typename Handler>
+  static ReadResult dispatch( Talker &talker, Handler &&handler )
+  {
+    return dispatch( talker, std::forward<Handler>( handler ), []( int16_t ) { } );
+  }
+
+  //! The highest priority of all types.
+  static constexpr uint8_t max_priority()
+  {
+    uint8_t result = 0;
+    ( ( result = object_priority<Ts>() > result ? object_priority<Ts>() : result ), ... );
+    return result;
+  }
+
+  /*!
+   * Keeps the newest object of each registered type.
+   * Used as handler for dispatch to skip older frames of the same type if multiple frames are
+   * buffered. Afterwards, the newest objects are passed on using dispatch in priority order.
+   */
+  class Latest
+  {
+  public:
+    template<typename T>
+    void operator()( const T &obj )
+    {
+      std::get<std::optional<T>>( objects_ ) = obj;
+    }
+
+    //! Calls the handler with each stored object, highest priority first, and clears them.
+    template<typename Handler>
+    void dispatch( Handler &&handler )
+    {
+      for ( int level = max_priority(); level >= 0; --level ) {
+        ( _dispatch<Ts>( level, handler ), ... );
+      }
+    }
+
+    bool empty() const { return ( !std::get<std::optional<Ts>>( objects_ ).has_value() && ... ); }
+
+  private:
+    template<typename T, typename Handler>
+    void _dispatch( int level, Handler &handler )
+    {
+      auto &obj = std::get<std::optional<T>>( objects_ );
+      if ( object_priority<T>() != level || !obj.has_value() )
+        return;
+      handler( static_cast<const T &>( *obj ) );
+      obj.reset();
+    }
+
+    std::tuple<std::optional<Ts>...> objects_;
+  };
+};
 } // namespace crosstalk
 
 #endif // CROSSTALK_CROSSTALKER_HPP
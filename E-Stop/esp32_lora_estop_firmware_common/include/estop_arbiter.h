@@ -0,0 +1,236 @@
+#pragma once
+
+#include "comm_transport.h"
+
+// E-Stop property payload: state, sequence and the little endian sender time in ms.
+// Receivers that only read the state byte are not affected by the trace.
+static constexpr size_t ESTOP_PROPERTY_SIZE = 6;
+static_assert( ESTOP_PROPERTY_SIZE <= MAX_PROPERTY_SIZE, "E-Stop property exceeds the capacity" );
+
+//! Without a received E-Stop state for this long, the E-Stop is considered active.
+static constexpr unsigned long ESTOP_TIMEOUT_MS = 300;
+
+inline PropertyValue encodeEStopProperty( bool active, uint8_t sequence, uint32_t time_ms )
+{
+  return { static_cast<uint8_t>( active ? 0xff : 0 ),
+           sequence,
+           static_cast<uint8_t>( time_ms ),
+           static_cast<uint8_t>( time_ms >> 8 ),
+           static_cast<uint8_t>( time_ms >> 16 ),
+           static_cast<uint8_t>( time_ms >> 24 ) };
+}
+
+// Soft E-Stop property payload: state and sequence.
+inline PropertyValue encodeSoftEStopProperty( bool active, uint8_t sequence )
+{
+  return { static_cast<uint8_t>( active ? 0xff : 0 ), sequence };
+}
+
+//! Missing data is treated as active to fail safe.
+inline bool readEStopState( const PropertyValue &data )
+{
+  return data.empty() || data[0] != 0;
+}
+
+//! Whether sequence a was sent after b. Valid while less than 128 packets are in between.
+inline bool isNewerSequence( uint8_t a, uint8_t b ) { return static_cast<int8_t>( a - b ) > 0; }
+
+//! An unchanged state is sent with a new sequence at most this often. 128 sequences then span at
+//! least 6.4 s, much longer than the ESTOP_TIMEOUT_MS after which any packet is accepted.
+static constexpr unsigned long ESTOP_RESEND_INTERVAL_MS = 50;
+
+/*!
+ * Numbers the states sent by the sender. A new sequence is taken if the state changed or the resend
+ * interval passed, other updates are not sent.
+ * The sender sets its state in every loop iteration while a button differs from the latched state.
+ * Numbering every call would wrap the sequence within 256 ms, so a LoRa packet that was on air for
+ * 200 ms could appear newer than the packets that overtook it.
+ */
+class EStopSequencer
+{
+public:
+  explicit EStopSequencer( unsigned long resend_interval_ms = ESTOP_RESEND_INTERVAL_MS )
+      : resend_interval_ms_( resend_interval_ms )
+  {
+  }
+
+  //! Returns true if the state has to be sent with getSequence().
+  bool update( bool active, unsigned long now_ms )
+  {
+    if ( started_ && active == active_ && now_ms - sequence_time_ms_ < resend_interval_ms_ )
+      return false;
+    started_ = true;
+    active_ = active;
+    ++sequence_;
+    sequence_time_ms_ = now_ms;
+    return true;
+  }
+
+  uint8_t getSequence() const { return sequence_; }
+
+private:
+  unsigned long resend_interval_ms_;
+  unsigned long sequence_time_ms_ = 0;
+  uint8_t sequence_ = 0;
+  bool active_ = false;
+  bool started_ = false;
+};
+
+/*!
+ * Decides the E-Stop and soft E-Stop state of the receiver from the properties received by all
+ * transports and keeps the trace of the received E-Stop state.
+ * Every packet carries a sequence number, the newest packet wins no matter which transport it
+ * arrived with. Older packets that arrive late using a slower transport and copies of a packet that
+ * already arrived are discarded.
+ * Independent of the Arduino framework, the current time is passed in.
+ */
+class EStopArbiter
+{
+public:
+  void update( TransportInterface *const *transports, size_t count, unsigned long now_ms )
+  {
+    for ( size_t i = 0; i < count; ++i ) {
+      TransportInterface *transport = transports[i];
+      if ( transport == nullptr || transport->getCommState() != CommState::CONNECTED )
+        continue;
+      const size_t index = static_cast<size_t>( transport->getTransportType() );
+      if ( index >= NUM_TRANSPORT_TYPES )
+        continue;
+      Link &link = links_[index];
+      if ( updateProperty( *transport, COMM_PROPERTY_ID_ESTOP, estop_, link.estop,
+                           &link.statistics, now_ms ) )
+        updateTrace( transport->getTransportType(), data_,
+                     estop_.receive_time_ms + transport->getTransmitDurationMs() );
+      updateProperty( *transport, COMM_PROPERTY_ID_SOFT_ESTOP, soft_estop_, link.soft_estop,
+                      nullptr, now_ms );
+    }
+    estop_active_ = !estop_.received || now_ms - estop_.receive_time_ms > ESTOP_TIMEOUT_MS ||
+                    estop_.active;
+    // The soft E-Stop has no timeout, it is only active while no transport is connected
+    soft_estop_active_ = !soft_estop_.received ||
+                         now_ms - soft_estop_.receive_time_ms >= COMM_CONNECTION_TIMEOUT_MS ||
+                         soft_estop_.active;
+  }
+
+  bool isEStopActive() const { return estop_active_; }
+
+  bool isSoftEStopActive() const { return soft_estop_active_; }
+
+  const EStopTrace &getTrace() const { return trace_; }
+
+  const LinkStatistics &getStatistics( CommTransport transport ) const
+  {
+    static const LinkStatistics empty;
+    const size_t index = static_cast<size_t>( transport );
+    return index < NUM_TRANSPORT_TYPES ? links_[index].statistics : empty;
+  }
+
+  //! Age of the most recent E-Stop or soft E-Stop packet. UINT32_MAX if none was received yet.
+  uint32_t getLastReceivedAge( unsigned long now_ms ) const
+  {
+    if ( !estop_.received && !soft_estop_.received )
+      return UINT32_MAX;
+    unsigned long receive_time_ms = estop_.received ? estop_.receive_time_ms
+                                                    : soft_estop_.receive_time_ms;
+    // Compared using the difference to handle the wrap around of the clock
+    if ( estop_.received && soft_estop_.received &&
+         static_cast<long>( soft_estop_.receive_time_ms - receive_time_ms ) > 0 )
+      receive_time_ms = soft_estop_.receive_time_ms;
+    return static_cast<uint32_t>( now_ms - receive_time_ms );
+  }
+
+private:
+  static constexpr size_t NUM_TRANSPORT_TYPES = static_cast<size_t>( CommTransport::ESP_NOW ) + 1;
+
+  //! The newest packet of a property received using any transport.
+  struct MergedProperty {
+    bool received = false;
+    bool active = true;
+    uint8_t sequence = 0;
+    //! Receive time of the first arrival minus the transmit duration of its transport.
+    unsigned long receive_time_ms = 0;
+  };
+
+  //! The last packet of a property received using a single transport.
+  struct LinkProperty {
+    bool received = false;
+    //! The newest sequence and its receive time.
+    uint8_t sequence = 0;
+    unsigned long receive_time_ms = 0;
+    //! The sequence read last, which may be older if the transport reordered packets.
+    uint8_t read_sequence = 0;
+  };
+
+  struct Link {
+    LinkProperty estop;
+    LinkProperty soft_estop;
+    LinkStatistics statistics;
+  };
+
+  //! Returns true if the transport received the newest packet of the property.
+  bool updateProperty( const TransportInterface &transport, uint8_t id, MergedProperty &merged,
+                       LinkProperty &link, LinkStatistics *statistics, unsigned long now_ms )
+  {
+    unsigned long age_ms = ULONG_MAX;
+    transport.readProperty( id, data_, age_ms );
+    if ( age_ms == ULONG_MAX || data_.size() < 2 )
+      return false; // Nothing received or sender without sequence, times out to the safe state
+    const uint8_t sequence = data_[1];
+    if ( link.received && sequence == link.read_sequence )
+      return false; // Already seen, the transports keep the last packet
+    link.read_sequence = sequence;
+    if ( statistics != nullptr )
+      ++statistics->received;
+    // The sequences of a link are only compared within the timeout, e.g., not after an outage
+    const bool link_recent = link.received && now_ms - link.receive_time_ms <= ESTOP_TIMEOUT_MS;
+    if ( link_recent && !isNewerSequence( sequence, link.sequence ) ) {
+      // Overtaken by a newer packet of the same transport, which was counted as lost
+      if ( statistics != nullptr ) {
+        ++statistics->reordered;
+        if ( transport.sendsEveryUpdate() && statistics->lost > 0 )
+          --statistics->lost;
+      }
+      return false;
+    }
+    if ( statistics != nullptr ) {
+      const uint8_t gap = sequence - link.sequence - 1;
+      if ( link_recent && transport.sendsEveryUpdate() && gap < 128 )
+        statistics->lost += gap;
+    }
+    link.received = true;
+    link.sequence = sequence;
+    link.receive_time_ms = now_ms;
+
+    // After a timeout, e.g., if the sender restarted, the next packet is accepted as the newest.
+    // Packets that another transport delivered first are expected, they are not counted.
+    const bool timed_out = now_ms - merged.receive_time_ms > ESTOP_TIMEOUT_MS;
+    if ( merged.received && !timed_out && !isNewerSequence( sequence, merged.sequence ) )
+      return false;
+    merged.received = true;
+    merged.active = readEStopState( data_ );
+    merged.sequence = sequence;
+    merged.receive_time_ms = now_ms - age_ms - transport.getTransmitDurationMs();
+    return true;
+  }
+
+  void updateTrace( CommTransport transport, const PropertyValue &data,
+                    unsigned long receive_time_ms )
+  {
+    trace_.sequence = data[1];
+    trace_.transport = transport;
+    trace_.sender_time_valid = data.size() >= ESTOP_PROPERTY_SIZE;
+    trace_.sender_time_ms = trace_.sender_time_valid
+                                ? data[2] | ( data[3] << 8 ) | ( data[4] << 16 ) |
+                                      ( static_cast<uint32_t>( data[5] ) << 24 )
+                                : 0;
+    trace_.receive_time_ms = receive_time_ms;
+  }
+
+  bool estop_active_ = true;
+  bool soft_estop_active_ = true;
+  MergedProperty estop_;
+  MergedProperty soft_estop_;
+  Link links_[NUM_TRANSPORT_TYPES];
+  EStopTrace trace_;
+  PropertyValue data_;
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "crosstalk.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+// Log records are binary objects with a message id and up to two integer arguments.
+// The format strings are only needed to print a record, which the host does for the receiver.
+
+// Records below this level are removed at compile time. Override with -DESTOP_LOG_LEVEL=<level>.
+#define ESTOP_LOG_LEVEL_DEBUG 0
+#define ESTOP_LOG_LEVEL_INFO 1
+#define ESTOP_LOG_LEVEL_WARNING 2
+#define ESTOP_LOG_LEVEL_ERROR 3
+#define ESTOP_LOG_LEVEL_NONE 4
+#ifndef ESTOP_LOG_LEVEL
+  #define ESTOP_LOG_LEVEL ESTOP_LOG_LEVEL_INFO
+#endif
+
+// Each message is passed on at most ESTOP_LOG_BURST times per ESTOP_LOG_WINDOW_MS.
+// The number of dropped records is reported with the next record of the same message.
+#ifndef ESTOP_LOG_BURST
+  #define ESTOP_LOG_BURST 3
+#endif
+#ifndef ESTOP_LOG_WINDOW_MS
+  #define ESTOP_LOG_WINDOW_MS 1000
+#endif
+
+enum class LogLevel : uint8_t {
+  DEBUG = ESTOP_LOG_LEVEL_DEBUG,
+  INFO = ESTOP_LOG_LEVEL_INFO,
+  WARNING = ESTOP_LOG_LEVEL_WARNING,
+  ERROR = ESTOP_LOG_LEVEL_ERROR,
+};
+
+enum class LogSubsystem : uint8_t {
+  MAIN = 0,
+  COMM = 1,
+  LORA = 2,
+  BLE = 3,
+  ESP_NOW = 4,
+  DEADMAN = 5,
+  HOST = 6,
+};
+
+// Append new messages at the end to keep the ids stable between firmware and host versions.
+// BLE addresses are passed as LOG_ADDRESS_ARGS and printed as 12 hex digits.
+#define ESTOP_LOG_MESSAGES( X )                                                                    \
+  X( STARTING, "Starting HECTOR E-Stop Remote..." )                                                \
+  X( COMM_INITIALIZED, "CommInterface initialized" )                                               \
+  X( DEADMAN_INITIALIZED, "DeadmanCommInterface initialized" )                                     \
+  X( SET_ENABLED, "Set E-Stop enabled to: %d" )                                                    \
+  X( UNKNOWN_OBJECT_ID, "Skipped object with unknown ID: %d" )                                     \
+  X( READ_OBJECT_FAILED, "Failed to read object, result: %d" )                                     \
+  X( BLE_INIT_SERVER, "Initializing BLE in server mode..." )                                       \
+  X( BLE_INIT_CLIENT, "Initializing BLE in client mode..." )                                       \
+  X( BLE_DEVICE_ADDRESS, "BLE Device initialized with address: %04X%08X" )                         \
+  X( BLE_RSSI_READ_FAILED, "Failed to read RSSI for %04X%08X" )                                    \
+  X( BLE_NOT_CONNECTED, "Not connected or characteristic not found" )                              \
+  X( BLE_CHARACTERISTIC_NOT_FOUND, "Characteristic %d not found" )                                 \
+  X( BLE_CLIENT_CONNECTED, "BLE client (%04X%08X) connected" )                                     \
+  X( BLE_UNEXPECTED_ADDRESS, "Connected to unexpected address: %04X%08X" )                         \
+  X( BLE_CLIENT_ALREADY_CONNECTED, "Client already in connected clients list" )                    \
+  X( BLE_CLIENT_DISCONNECTED, "BLE client (%04X%08X) disconnected" )                               \
+  X( BLE_SERVER_CONNECTED, "BLE server connected" )                                                \
+  X( BLE_SERVICE_NOT_FOUND, "Failed to find service" )                                             \
+  X( BLE_CONNECTING, "Connecting to BLE server" )                                                  \
+  X( BLE_PASSKEY_REQUESTED, "Passkey entry requested." )                                           \
+  X( BLE_CONNECT_FAILED, "Failed to connect to BLE server: %d" )                                   \
+  X( BLE_SERVER_DISCONNECTED, "BLE server disconnected" )                                          \
+  X( ESP_NOW_ADD_PEER_FAILED, "Failed to add ESP-NOW peer" )                                       \
+  X( ESP_NOW_PEER_ADDED, "ESP-NOW peer added successfully" )                                       \
+  X( ESP_NOW_INVALID_PROPERTY, "Received packet with invalid property index" )                     \
+  X( LORA_INIT_ERROR, "Radio initialization error: %d" )                                           \
+  X( LORA_TRANSMIT_ERROR, "Radio transmit error: %d" )                                             \
+  X( LORA_TRANSMIT_TIMEOUT, "Sent was never set to true." )                                        \
+  X( LORA_READ_ERROR, "Radio read error: %d" )                                                     \
+  X( LORA_UNKNOWN_PROPERTY, "Received unknown property ID: %d" )                                   \
+  X( ESP_NOW_MAILBOX_FULL, "Dropped %d received ESP-NOW packets, mailbox full" )                   \
+  X( BLE_MAILBOX_FULL, "Dropped %d BLE notifications, mailbox full" )                              \
+  X( ESP_NOW_PEER_TABLE_FULL, "ESP-NOW peer table full, at most %d peers are supported" )          \
+  X( LORA_INVALID_FRAME, "Dropped invalid LoRa packet with %d bytes" )                             \
+  X( LORA_DUTY_CYCLE_EXHAUSTED, "LoRa duty-cycle budget spent, %d ms on air in the last hour" )    \
+  X( LORA_CONFIG_CHANGED, "LoRa switched to SF%d at %d kHz" )                                      \
+  X( LORA_CONFIG_ERROR, "Radio configuration error: %d" )                                          \
+  X( LORA_RENDEZVOUS, "LoRa link lost, falling back to the rendezvous configuration" )             \
+  X( LORA_MAILBOX_FULL, "Dropped %d received LoRa frames, mailbox full" )                          \
+  X( HOST_TX_QUEUE_FULL, "Dropped %d log records, host TX queue full" )
+
+#define ESTOP_LOG_MESSAGE_ID( name, format ) name,
+enum class LogMessage : uint16_t { ESTOP_LOG_MESSAGES( ESTOP_LOG_MESSAGE_ID ) COUNT };
+#undef ESTOP_LOG_MESSAGE_ID
+
+struct LogRecord {
+  LogLevel level = LogLevel::INFO;
+  LogSubsystem subsystem = LogSubsystem::MAIN;
+  LogMessage message = LogMessage::COUNT;
+  //! Records of the same message dropped by the rate limiter since the last record.
+  uint16_t suppressed = 0;
+  std::array<int32_t, 2> args = {};
+};
+
+REFL_AUTO( type( LogRecord, crosstalk::id( 0x05 ) ), field( level ), field( subsystem ),
+           field( message ), field( suppressed ), field( args ) )
+
+//! Splits a 48 bit BLE address into the two arguments of an address format.
+#define LOG_ADDRESS_ARGS( address )                                                                \
+  static_cast<int32_t>( static_cast<uint64_t>( address ) >> 32 ),                                  \
+      static_cast<int32_t>( static_cast<uint64_t>( address ) )
+
+#define ESTOP_LOG( level, subsystem, message, ... )                                                \
+  do {                                                                                             \
+    if constexpr ( ESTOP_LOG_LEVEL_##level >= ESTOP_LOG_LEVEL )                                    \
+      logMessage( LogLevel::level, LogSubsystem::subsystem, LogMessage::message, ##__VA_ARGS__ );  \
+  } while ( false )
+
+#define ESTOP_LOG_DEBUG( subsystem, message, ... )                                                 \
+  ESTOP_LOG( DEBUG, subsystem, message, ##__VA_ARGS__ )
+#define ESTOP_LOG_INFO( subsystem, message, ... )                                                  \
+  ESTOP_LOG( INFO, subsystem, message, ##__VA_ARGS__ )
+#define ESTOP_LOG_WARNING( subsystem, message, ... )                                               \
+  ESTOP_LOG( WARNING, subsystem, message, ##__VA_ARGS__ )
+#define ESTOP_LOG_ERROR( subsystem, message, ... )                                                 \
+  ESTOP_LOG( ERROR, subsystem, message, ##__VA_ARGS__ )
+
+//! Receives every record that passed the level filter and the rate limiter.
+using LogSink = void ( * )( const LogRecord &record );
+
+/*!
+ * Sets the sink for log records. Defaults to printing on Serial.
+ * The sink may be called from any task, e.g., BLE and ESP-NOW callbacks, and has to be thread-safe.
+ */
+void setLogSink( LogSink sink );
+
+//! Use the ESTOP_LOG macros instead to remove disabled levels at compile time.
+void logMessage( LogLevel level, LogSubsystem subsystem, LogMessage message, int32_t arg0 = 0,
+                 int32_t arg1 = 0 );
+
+inline const char *logLevelName( LogLevel level )
+{
+  switch ( level ) {
+  case LogLevel::DEBUG:
+    return "DEBUG";
+  case LogLevel::INFO:
+    return "INFO";
+  case LogLevel::WARNING:
+    return "WARNING";
+  case LogLevel::ERROR:
+    return "ERROR";
+  }
+  return "UNKNOWN";
+}
+
+inline const char *logSubsystemName( LogSubsystem subsystem )
+{
+  switch ( subsystem ) {
+  case LogSubsystem::MAIN:
+    return "main";
+  case LogSubsystem::COMM:
+    return "comm";
+  case LogSubsystem::LORA:
+    return "lora";
+  case LogSubsystem::BLE:
+    return "ble";
+  case LogSubsystem::ESP_NOW:
+    return "esp_now";
+  case LogSubsystem::DEADMAN:
+    return "deadman";
+  case LogSubsystem::HOST:
+    return "host";
+  }
+  return "unknown";
+}
+
+//! Returns nullptr for unknown messages, e.g., if the firmware is newer than the host.
+inline const char *logFormat( LogMessage message )
+{
+#define ESTOP_LOG_MESSAGE_FORMAT( name, format ) format,
+  static constexpr const char *formats[] = { ESTOP_LOG_MESSAGES( ESTOP_LOG_MESSAGE_FORMAT ) };
+#undef ESTOP_LOG_MESSAGE_FORMAT
+  const auto index = static_cast<uint16_t>( message );
+  return index < static_cast<uint16_t>( LogMessage::COUNT ) ? formats[index] : nullptr;
+}
+
+//! Formats the message of the record into the buffer. Returns the length as snprintf does.
+inline int formatLogRecord( const LogRecord &record, char *buffer, size_t size )
+{
+  const char *format = logFormat( record.message );
+  int length = 0;
+  if ( format == nullptr ) {
+    length = snprintf( buffer, size, "Unknown log message %u (%d, %d)",
+                       static_cast<unsigned>( record.message ), record.args[0], record.args[1] );
+  } else {
+    length = snprintf( buffer, size, format, record.args[0], record.args[1] );
+  }
+  if ( record.suppressed > 0 && length >= 0 && static_cast<size_t>( length ) < size ) {
+    length += snprintf( buffer + length, size - length, " (%u similar messages suppressed)",
+                        static_cast<unsigned>( record.suppressed ) );
+  }
+  return length;
+}
@@ -2,10 +2,14 @@
 
 #include "comm_interface.h"
 #include "crosstalk.hpp"
+#include "estop_log.h"
+
+REFL_AUTO( type( LinkStatistics ), field( received ), field( lost ), field( reordered ) )
 
 REFL_AUTO( type( CommStatus, crosstalk::id( 0x01 ) ), field( last_received_message_age_ms ),
            field( ble_rssi ), field( radio_rssi ), field( esp_now_rssi ), field( ble_state ),
-           field( esp_now_state ), field( radio_state ) )
+           field( esp_now_state ), field( radio_state ), field( ble_statistics ),
+           field( esp_now_statistics ), field( radio_statistics ) )
 
 struct EStopReceiverStatus {
   CommStatus remote_status;
@@ -15,19 +19,37 @@ struct EStopReceiverStatus {
 REFL_AUTO( type( EStopReceiverStatus, crosstalk::id( 0x03 ) ), field( remote_status ),
            field( deadman_status ) )
 
+REFL_AUTO( type( EStopTrace ), field( sequence ), field( transport ), field( sender_time_valid ),
+           field( sender_time_ms ), field( receive_time_ms ) )
+
 struct EStopState {
   bool enabled = false;
   bool hard_estop_active = false;
   bool soft_estop_active = false;
   bool deadman_active = false;
   bool deadman_triggered = false;
+  //! Trace of the hard E-Stop state.
+  EStopTrace trace;
+  //! Receiver clock time in ms when this object was queued for sending.
+  uint32_t send_time_ms = 0;
 };
 
-REFL_AUTO( type( EStopState, crosstalk::id( 0x02 ) ), field( enabled ), field( hard_estop_active ),
-           field( soft_estop_active ), field( deadman_active ), field( deadman_triggered ) )
+// E-Stop related objects have a higher priority to overtake queued status objects
+REFL_AUTO( type( EStopState, crosstalk::id( 0x02 ), crosstalk::priority( 1 ) ), field( enabled ),
+           field( hard_estop_active ), field( soft_estop_active ), field( deadman_active ),
+           field( deadman_triggered ), field( trace ), field( send_time_ms ) )
 
 struct SetEnabledCommand {
   bool enabled = true;
 };
 
-REFL_AUTO( type( SetEnabledCommand, crosstalk::id( 0x03 ) ), field( enabled ) )
+// Shares the ID with EStopReceiverStatus, which is only sent in the other direction. Kept to stay
+// compatible with hosts and receivers of earlier versions.
+REFL_AUTO( type( SetEnabledCommand, crosstalk::id( 0x03 ), crosstalk::priority( 1 ) ),
+           field( enabled ) )
+
+//! Objects sent from the receiver to the host.
+using ReceiverToHostObjects = crosstalk::Registry<EStopState, EStopReceiverStatus, LogRecord>;
+//! Objects sent from the host to the receiver.
+using HostToReceiverObjects = crosstalk::Registry<SetEnabledCommand>;
+// IDs only have to be unique per direction, which each registry checks at compile time
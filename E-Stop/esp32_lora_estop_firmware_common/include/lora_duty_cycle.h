@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+
+//! EU868 sub-band g3 (869.4 - 869.65 MHz) allows a duty cycle of 10 % at up to 500 mW ERP.
+static constexpr uint32_t LORA_DUTY_CYCLE_PERMILLE = 100;
+
+//! ETSI EN 300 220 measures the duty cycle over one hour.
+static constexpr uint32_t LORA_DUTY_CYCLE_WINDOW_MS = 3600000;
+
+//! Share of the budget that the periodic packets leave to urgent ones, i.e., after an E-Stop change.
+static constexpr uint32_t LORA_URGENT_RESERVE_PERCENT = 20;
+
+//! Number of urgent packets sent after a change, so a single lost packet does not delay it.
+static constexpr uint8_t LORA_URGENT_PACKETS = 3;
+
+/*!
+ * Keeps the airtime of the LoRa transmissions within the duty-cycle budget of a sliding window.
+ * Periodic packets are paced so they spend the budget without the reserve evenly, which is the
+ * highest rate that can be sustained. Urgent packets are sent as soon as the radio is free. Both
+ * are only limited by the whole budget, the pacing leaves the reserve to the urgent packets. A
+ * separate limit for the periodic packets would let urgent packets delay them, so the receiver
+ * would see losses.
+ * The airtime is accounted in buckets of one minute. One more bucket than the window is kept, so
+ * the tracked airtime covers at least the last window and the budget is never exceeded.
+ */
+class LoraDutyCycle
+{
+public:
+  explicit LoraDutyCycle( uint32_t duty_cycle_permille = LORA_DUTY_CYCLE_PERMILLE,
+                          uint32_t reserve_percent = LORA_URGENT_RESERVE_PERCENT )
+      : budget_us_( LORA_DUTY_CYCLE_WINDOW_MS * duty_cycle_permille ),
+        periodic_budget_us_( budget_us_ / 100 * ( 100 - reserve_percent ) )
+  {
+  }
+
+  //! Interval between the starts of periodic packets with the given airtime.
+  uint32_t getInterval( uint32_t airtime_us ) const
+  {
+    if ( periodic_budget_us_ == 0 )
+      return LORA_DUTY_CYCLE_WINDOW_MS;
+    const uint64_t interval_ms =
+        static_cast<uint64_t>( airtime_us ) * LORA_DUTY_CYCLE_WINDOW_MS / periodic_budget_us_;
+    return interval_ms < LORA_DUTY_CYCLE_WINDOW_MS ? static_cast<uint32_t>( interval_ms )
+                                                   : LORA_DUTY_CYCLE_WINDOW_MS;
+  }
+
+  //! Returns the time in ms until a packet with the given airtime may be started, 0 if it may now.
+  uint32_t getDelay( uint32_t airtime_us, bool urgent, uint32_t now_ms )
+  {
+    advance( now_ms );
+    uint32_t delay_ms = 0;
+    if ( !urgent && has_sent_ ) {
+      const uint32_t elapsed_ms = now_ms - last_send_ms_;
+      const uint32_t interval_ms = getInterval( airtime_us );
+      delay_ms = elapsed_ms < interval_ms ? interval_ms - elapsed_ms : 0;
+    }
+    if ( used_us_ + airtime_us <= budget_us_ )
+      return delay_ms;
+    // Wait until enough of the oldest buckets dropped out of the window
+    const uint32_t excess_us = used_us_ + airtime_us - budget_us_;
+    uint32_t freed_us = 0;
+    for ( uint32_t i = 1; i <= WINDOW_BUCKETS; ++i ) {
+      freed_us += buckets_[( current_ + i ) % BUCKETS];
+      if ( freed_us >= excess_us ) {
+        const uint32_t wait_ms = i * BUCKET_MS - ( now_ms - bucket_start_ms_ );
+        return wait_ms > delay_ms ? wait_ms : delay_ms;
+      }
+    }
+    return LORA_DUTY_CYCLE_WINDOW_MS; // The packet is longer than the budget
+  }
+
+  //! Accounts a packet that was started now.
+  void addTransmission( uint32_t airtime_us, uint32_t now_ms )
+  {
+    advance( now_ms );
+    buckets_[current_] += airtime_us;
+    used_us_ += airtime_us;
+    last_send_ms_ = now_ms;
+    has_sent_ = true;
+  }
+
+  //! Airtime in us spent within the tracked window.
+  uint32_t getUsed( uint32_t now_ms )
+  {
+    advance( now_ms );
+    return used_us_;
+  }
+
+  uint32_t getBudget() const { return budget_us_; }
+
+private:
+  static constexpr uint32_t BUCKET_MS = 60000;
+  static constexpr uint32_t WINDOW_BUCKETS = LORA_DUTY_CYCLE_WINDOW_MS / BUCKET_MS;
+  static constexpr uint32_t BUCKETS = WINDOW_BUCKETS + 1;
+
+  //! Drops the buckets that left the window. Wrap-safe, as millis() overflows after 49 days.
+  void advance( uint32_t now_ms )
+  {
+    if ( !started_ ) {
+      bucket_start_ms_ = now_ms;
+      started_ = true;
+      return;
+    }
+    const uint32_t elapsed_ms = now_ms - bucket_start_ms_;
+    if ( elapsed_ms < BUCKET_MS )
+      return;
+    const uint32_t steps = elapsed_ms / BUCKET_MS;
+    for ( uint32_t i = 0; i < steps && i < BUCKETS; ++i ) {
+      current_ = ( current_ + 1 ) % BUCKETS;
+      used_us_ -= buckets_[current_];
+      buckets_[current_] = 0;
+    }
+    bucket_start_ms_ += steps * BUCKET_MS;
+  }
+
+  uint32_t budget_us_;
+  uint32_t periodic_budget_us_;
+  //! Airtime in us started within each bucket, the current one is still filling.
+  uint32_t buckets_[BUCKETS] = {};
+  uint32_t used_us_ = 0;
+  uint32_t current_ = 0;
+  uint32_t bucket_start_ms_ = 0;
+  uint32_t last_send_ms_ = 0;
+  bool started_ = false;
+  bool has_sent_ = false;
+};
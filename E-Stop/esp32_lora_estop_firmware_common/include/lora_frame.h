@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * LoRa packets carry the whole safety state of the sender, so every packet updates the E-Stop and
+ * the soft E-Stop at the same time-on-air.
+ *
+ * Layout of the 4 bytes:
+ *   0: bit 7 E-Stop active, bit 6 soft E-Stop active, bit 5 battery level valid, bit 4 switch,
+ *      bits 0-3 battery level in steps of 1/15 or, if the switch bit is set, the next configuration
+ *   1: sequence of the E-Stop property
+ *   2: sequence of the soft E-Stop property
+ *   3: CRC-8/AUTOSAR of bytes 0-2
+ * The sequences are the ones sent with the properties over BLE and ESP-NOW, so the receiver can
+ * arbitrate between the transports.
+ * With the switch bit, the server announces that it changes the LoRa configuration after this
+ * packet, see lora_link_adaptation.h. These packets do not carry the battery level.
+ * At SF9 the fourth byte adds a block of 7 symbols, about 28 ms, to the airtime of a 3 byte packet.
+ * At SF7, payloads of 3 to 5 bytes have the same airtime.
+ */
+static constexpr size_t LORA_FRAME_SIZE = 4;
+
+struct LoraFrame {
+  bool estop_active = true;
+  bool soft_estop_active = true;
+  uint8_t estop_sequence = 0;
+  uint8_t soft_estop_sequence = 0;
+  bool battery_valid = false;
+  //! Battery level in percent, quantized to 16 steps in the frame.
+  uint8_t battery_level = 0;
+  bool switch_config = false;
+  //! Index into LORA_CONFIGS if switch_config is set.
+  uint8_t next_config = 0;
+};
+
+//! CRC-8/AUTOSAR (poly 0x2F), detects up to three bit errors in frames of this size.
+inline uint8_t loraFrameCrc( const uint8_t *data, size_t size )
+{
+  uint8_t crc = 0xFF;
+  for ( size_t i = 0; i < size; ++i ) {
+    crc ^= data[i];
+    for ( int bit = 0; bit < 8; ++bit )
+      crc = ( crc & 0x80 ) ? static_cast<uint8_t>( ( crc << 1 ) ^ 0x2F ) : crc << 1;
+  }
+  return crc ^ 0xFF;
+}
+
+inline void encodeLoraFrame( const LoraFrame &frame, uint8_t ( &data )[LORA_FRAME_SIZE] )
+{
+  const uint8_t level = frame.battery_level > 100 ? 100 : frame.battery_level;
+  data[0] = ( frame.estop_active ? 0x80 : 0 ) | ( frame.soft_estop_active ? 0x40 : 0 );
+  if ( frame.switch_config )
+    data[0] |= 0x10 | ( frame.next_config & 0x0F );
+  else if ( frame.battery_valid )
+    data[0] |= 0x20 | ( level * 15 + 50 ) / 100;
+  data[1] = frame.estop_sequence;
+  data[2] = frame.soft_estop_sequence;
+  data[3] = loraFrameCrc( data, LORA_FRAME_SIZE - 1 );
+}
+
+//! Returns false if the size or the CRC does not match or both the battery and the switch bit are
+//! set, e.g., for foreign packets.
+inline bool decodeLoraFrame( const uint8_t *data, size_t size, LoraFrame &frame )
+{
+  if ( size != LORA_FRAME_SIZE || ( data[0] & 0x30 ) == 0x30 ||
+       loraFrameCrc( data, LORA_FRAME_SIZE - 1 ) != data[3] )
+    return false;
+  frame.estop_active = ( data[0] & 0x80 ) != 0;
+  frame.soft_estop_active = ( data[0] & 0x40 ) != 0;
+  frame.battery_valid = ( data[0] & 0x20 ) != 0;
+  frame.battery_level = frame.battery_valid ? ( data[0] & 0x0F ) * 100 / 15 : 0;
+  frame.switch_config = ( data[0] & 0x10 ) != 0;
+  frame.next_config = frame.switch_config ? data[0] & 0x0F : 0;
+  frame.estop_sequence = data[1];
+  frame.soft_estop_sequence = data[2];
+  return true;
+}
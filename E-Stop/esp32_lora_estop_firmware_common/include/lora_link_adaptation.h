@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+
+struct LoraConfig {
+  uint8_t spreading_factor;
+  float bandwidth_khz;
+  //! SNR needed to demodulate, referred to a bandwidth of 125 kHz, i.e., the limit of the spreading
+  //! factor plus the higher noise of a wider bandwidth.
+  float required_snr_db;
+  //! Noise of the bandwidth relative to 125 kHz, added to measured SNRs to refer them to 125 kHz.
+  float bandwidth_offset_db;
+};
+
+/*!
+ * LoRa configurations ordered from the fastest to the most robust. All of them fit into sub-band
+ * g3, which is 250 kHz wide. Each step gains 2.5 to 3 dB of link budget and roughly doubles the
+ * airtime of a LoraFrame, so the duty cycle allows fewer packets.
+ */
+static constexpr LoraConfig LORA_CONFIGS[] = {
+    { 7, 250, -4.5f, 3 },
+    { 7, 125, -7.5f, 0 },
+    { 8, 125, -10.0f, 0 },
+    { 9, 125, -12.5f, 0 },
+    { 10, 125, -15.0f, 0 },
+};
+static constexpr uint8_t LORA_CONFIG_COUNT = sizeof( LORA_CONFIGS ) / sizeof( LORA_CONFIGS[0] );
+
+//! Both ends start with and fall back to the most robust configuration.
+static constexpr uint8_t LORA_RENDEZVOUS_CONFIG = LORA_CONFIG_COUNT - 1;
+
+//! Both ends fall back to the rendezvous configuration if the link was lost for this long.
+static constexpr uint32_t LORA_RENDEZVOUS_TIMEOUT_MS = 10000;
+
+//! The server ignores the feedback of the receiver for this long after switching, as feedback that
+//! was sent before the receiver followed may still arrive.
+static constexpr uint32_t LORA_FEEDBACK_SETTLE_MS = 1000;
+
+//! Number of packets that announce a switch on the old configuration.
+static constexpr uint8_t LORA_SWITCH_PACKETS = 3;
+
+//! The link is evaluated over windows of this many expected periodic packets.
+static constexpr uint32_t LORA_ADAPTATION_WINDOW_PACKETS = 8;
+
+//! A more robust configuration is requested if the SNR margin drops below this.
+static constexpr float LORA_MIN_MARGIN_DB = 5;
+
+//! A faster configuration is requested if it would still have this SNR margin.
+static constexpr float LORA_FASTER_MARGIN_DB = 10;
+
+//! A more robust configuration is requested if at least this share of the packets was lost.
+static constexpr uint32_t LORA_MAX_LOSS_PERCENT = 25;
+
+/*!
+ * Picks the fastest LoRa configuration that the link supports at the current distance, based on the
+ * SNR and the loss of the periodic packets measured by the receiver.
+ * The receiver sends the requested configuration to the server as feedback over BLE and ESP-NOW.
+ * The server announces the switch with flagged LoraFrames on the old configuration, the receiver
+ * switches when it receives one of them. If the link is lost, both ends fall back to the rendezvous
+ * configuration, the receiver if it received no frame and the server if it received no feedback.
+ */
+class LoraLinkAdaptation
+{
+public:
+  //! Called for every valid frame received with the current configuration.
+  void addPacket( float snr_db, uint32_t now_ms )
+  {
+    const float snr_125_db = snr_db + LORA_CONFIGS[config_].bandwidth_offset_db;
+    if ( window_packets_ == 0 || snr_125_db < window_min_snr_db_ )
+      window_min_snr_db_ = snr_125_db;
+    ++window_packets_;
+    last_packet_ms_ = now_ms;
+  }
+
+  /*!
+   * Evaluates the link once a window passed.
+   * @param interval_ms Interval of the periodic packets with the current configuration.
+   * @return True if the link was lost and the receiver has to switch to the rendezvous config.
+   */
+  bool update( uint32_t interval_ms, uint32_t now_ms )
+  {
+    if ( config_ != LORA_RENDEZVOUS_CONFIG &&
+         now_ms - last_packet_ms_ >= LORA_RENDEZVOUS_TIMEOUT_MS )
+      return true;
+    const uint32_t window_ms = interval_ms * LORA_ADAPTATION_WINDOW_PACKETS;
+    if ( now_ms - window_start_ms_ < window_ms )
+      return false;
+    // Urgent packets may exceed the expected count, they do not hide losses of a longer window.
+    // One missing packet is tolerated, the window may end just before a periodic packet.
+    const uint32_t missing = window_packets_ < LORA_ADAPTATION_WINDOW_PACKETS
+                                 ? LORA_ADAPTATION_WINDOW_PACKETS - window_packets_
+                                 : 0;
+    const uint32_t loss_percent = 100 * missing / LORA_ADAPTATION_WINDOW_PACKETS;
+    const float margin_db = window_min_snr_db_ - LORA_CONFIGS[config_].required_snr_db;
+    if ( window_packets_ == 0 || loss_percent >= LORA_MAX_LOSS_PERCENT ||
+         margin_db < LORA_MIN_MARGIN_DB ) {
+      requested_ = config_ + 1 < LORA_CONFIG_COUNT ? config_ + 1 : config_;
+    } else if ( config_ > 0 && missing <= 1 &&
+                window_min_snr_db_ - LORA_CONFIGS[config_ - 1].required_snr_db >=
+                    LORA_FASTER_MARGIN_DB ) {
+      requested_ = config_ - 1;
+    } else {
+      requested_ = config_;
+    }
+    window_start_ms_ = now_ms;
+    window_packets_ = 0;
+    return false;
+  }
+
+  //! Called after the radio was switched, the statistics of the old configuration are discarded.
+  void setConfig( uint8_t config, uint32_t now_ms )
+  {
+    config_ = config < LORA_CONFIG_COUNT ? config : LORA_RENDEZVOUS_CONFIG;
+    requested_ = config_;
+    window_start_ms_ = now_ms;
+    window_packets_ = 0;
+    last_packet_ms_ = now_ms;
+  }
+
+  uint8_t getConfig() const { return config_; }
+
+  //! The configuration the receiver asks the server to switch to.
+  uint8_t getRequestedConfig() const { return requested_; }
+
+private:
+  uint8_t config_ = LORA_RENDEZVOUS_CONFIG;
+  uint8_t requested_ = LORA_RENDEZVOUS_CONFIG;
+  uint32_t window_start_ms_ = 0;
+  uint32_t window_packets_ = 0;
+  float window_min_snr_db_ = 0;
+  uint32_t last_packet_ms_ = 0;
+};
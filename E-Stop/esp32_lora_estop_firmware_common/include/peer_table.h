@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * Fixed size open-addressed table from 6 byte MAC addresses to peers, e.g., the ESP-NOW connections.
+ * Lookups are lock-free and do not allocate, so they can be done in the WiFi callbacks. The
+ * promiscuous callback looks up the sender of every management frame in range, including all
+ * foreign beacons, hence, most addresses are rejected by a 32 bit filter of the peer hashes before
+ * probing the table.
+ * Peers are inserted and removed by a single task while lookups may run concurrently on others.
+ * A lookup that started before a peer was removed may still return it.
+ * Only 32 bit atomics are used as 64 bit atomics are not lock-free on the ESP32.
+ * @tparam Slots Number of slots, a power of two. At most half of them are used to keep probes short.
+ */
+template<typename T, size_t Slots = 32>
+class PeerTable
+{
+  static_assert( Slots >= 2 && ( Slots & ( Slots - 1 ) ) == 0, "Slots has to be a power of two" );
+
+public:
+  static constexpr size_t MAX_PEERS = Slots / 2;
+
+  //! The address split into two words and its hash, computed once per lookup.
+  struct Key {
+    explicit Key( const uint8_t mac[6] )
+        : Key( static_cast<uint32_t>( mac[0] ) << 24 | static_cast<uint32_t>( mac[1] ) << 16 |
+                   static_cast<uint32_t>( mac[2] ) << 8 | mac[3],
+               OCCUPIED | static_cast<uint32_t>( mac[4] ) << 8 | mac[5] )
+    {
+    }
+
+    Key( uint32_t high, uint32_t low ) : high( high ), low( low )
+    {
+      hash = ( high ^ ( low * 0x9E3779B1u ) ) * 0x85EBCA6Bu;
+      hash ^= hash >> 16;
+    }
+
+    uint32_t high;
+    uint32_t low;
+    uint32_t hash;
+  };
+
+  //! Returns false if the table is full or the address is already in the table.
+  bool insert( const uint8_t mac[6], T *value )
+  {
+    if ( value == nullptr || size_ >= MAX_PEERS )
+      return false;
+    const Key key( mac );
+    Slot *free_slot = nullptr;
+    for ( size_t i = 0; i < Slots; ++i ) {
+      Slot &slot = slots_[( key.hash + i ) & ( Slots - 1 )];
+      const uint32_t low = slot.low.load( std::memory_order_relaxed );
+      if ( low == key.low && slot.high.load( std::memory_order_relaxed ) == key.high )
+        return false;
+      if ( free_slot == nullptr && ( low == EMPTY || low == TOMBSTONE ) )
+        free_slot = &slot;
+      if ( low == EMPTY )
+        break;
+    }
+    // The low word is published last, a lookup only reads the other fields after matching it
+    free_slot->high.store( key.high, std::memory_order_relaxed );
+    free_slot->value.store( value, std::memory_order_release );
+    free_slot->low.store( key.low, std::memory_order_release );
+    filter_.store( filter_.load( std::memory_order_relaxed ) | filterBit( key ),
+                   std::memory_order_release );
+    ++size_;
+    return true;
+  }
+
+  //! Returns false if the address is not in the table.
+  bool remove( const uint8_t mac[6] )
+  {
+    const size_t index = findSlot( Key( mac ) );
+    if ( index == Slots )
+      return false;
+    // Marked as a tombstone instead of emptied, so the probes of other keys continue past it
+    slots_[index].value.store( nullptr, std::memory_order_relaxed );
+    slots_[index].low.store( TOMBSTONE, std::memory_order_release );
+    --size_;
+    uint32_t filter = 0;
+    for ( const Slot &other : slots_ ) {
+      const uint32_t low = other.low.load( std::memory_order_relaxed );
+      if ( low != EMPTY && low != TOMBSTONE )
+        filter |= filterBit( Key( other.high.load( std::memory_order_relaxed ), low ) );
+    }
+    filter_.store( filter, std::memory_order_release );
+    return true;
+  }
+
+  //! Returns nullptr if the address is not in the table.
+  T *find( const uint8_t mac[6] ) const
+  {
+    const Key key( mac );
+    if ( ( filter_.load( std::memory_order_acquire ) & filterBit( key ) ) == 0 )
+      return nullptr;
+    const size_t index = findSlot( key );
+    if ( index == Slots )
+      return nullptr;
+    const Slot &slot = slots_[index];
+    T *value = slot.value.load( std::memory_order_acquire );
+    // The slot may have been removed and reused for another peer since its key was matched.
+    // The key of the new peer is stored before its value, hence, the check sees it.
+    if ( slot.low.load( std::memory_order_relaxed ) != key.low ||
+         slot.high.load( std::memory_order_relaxed ) != key.high )
+      return nullptr;
+    return value;
+  }
+
+  size_t size() const { return size_; }
+
+private:
+  // Keys always have the occupied bit set in the low word, so they are neither empty nor tombstones
+  static constexpr uint32_t EMPTY = 0;
+  static constexpr uint32_t TOMBSTONE = 1;
+  static constexpr uint32_t OCCUPIED = 1 << 16;
+
+  struct Slot {
+    std::atomic<uint32_t> low{ EMPTY };
+    std::atomic<uint32_t> high{ 0 };
+    std::atomic<T *> value{ nullptr };
+  };
+
+  static uint32_t filterBit( const Key &key ) { return 1u << ( key.hash >> 27 ); }
+
+  //! Returns the index of the slot with the key or Slots if it is not in the table.
+  size_t findSlot( const Key &key ) const
+  {
+    for ( size_t i = 0; i < Slots; ++i ) {
+      const size_t index = ( key.hash + i ) & ( Slots - 1 );
+      const uint32_t low = slots_[index].low.load( std::memory_order_acquire );
+      if ( low == EMPTY )
+        break;
+      if ( low == key.low && slots_[index].high.load( std::memory_order_relaxed ) == key.high )
+        return index;
+    }
+    return Slots;
+  }
+
+  Slot slots_[Slots];
+  std::atomic<uint32_t> filter_{ 0 };
+  //! Only accessed by the task inserting and removing peers.
+  size_t size_ = 0;
+};
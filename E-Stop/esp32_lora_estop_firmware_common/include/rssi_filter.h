@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//! Weight of a new sample in the RSSI average as a power of two, i.e., 1/8.
+static constexpr int RSSI_AVERAGE_SHIFT = 3;
+
+//! The RSSI minimum and maximum are computed over the last one to two windows of this length.
+static constexpr uint32_t RSSI_WINDOW_MS = 1000;
+
+struct RSSIStatistics {
+  //! Exponentially weighted moving average in dBm.
+  float average = 0;
+  int8_t min = 0;
+  int8_t max = 0;
+  //! False if no sample was added in the last two windows, min and max are 0 then.
+  bool valid = false;
+};
+
+/*!
+ * Smooths the RSSI samples of a peer and keeps their minimum and maximum over a window.
+ * Samples are added by a single task, e.g., the WiFi promiscuous callback, and read by others
+ * without locking. Each value is read atomically, but the average and the window may be from
+ * consecutive samples.
+ */
+class RSSIFilter
+{
+public:
+  //! Called by the sampling task only.
+  void add( int8_t rssi, uint32_t now_ms )
+  {
+    // Fixed point with 8 fractional bits, so small changes are not lost due to rounding
+    const int32_t sample = static_cast<int32_t>( rssi ) * 256;
+    int32_t average = average_.load( std::memory_order_relaxed );
+    average = has_samples_ ? average + ( sample - average ) / ( 1 << RSSI_AVERAGE_SHIFT ) : sample;
+    average_.store( average, std::memory_order_relaxed );
+
+    const uint32_t elapsed_ms = now_ms - window_start_ms_;
+    if ( !has_samples_ || elapsed_ms >= RSSI_WINDOW_MS ) {
+      // The previous window is only kept if it directly precedes the new one
+      has_previous_ = has_samples_ && elapsed_ms < 2 * RSSI_WINDOW_MS;
+      previous_min_ = current_min_;
+      previous_max_ = current_max_;
+      current_min_ = current_max_ = rssi;
+      window_start_ms_ = now_ms;
+    } else {
+      current_min_ = rssi < current_min_ ? rssi : current_min_;
+      current_max_ = rssi > current_max_ ? rssi : current_max_;
+    }
+    has_samples_ = true;
+    int8_t min = current_min_;
+    int8_t max = current_max_;
+    if ( has_previous_ ) {
+      min = previous_min_ < min ? previous_min_ : min;
+      max = previous_max_ > max ? previous_max_ : max;
+    }
+    window_.store( VALID | static_cast<uint8_t>( min ) | static_cast<uint8_t>( max ) << 8,
+                   std::memory_order_relaxed );
+    last_sample_ms_.store( now_ms, std::memory_order_release );
+  }
+
+  RSSIStatistics get( uint32_t now_ms ) const
+  {
+    RSSIStatistics statistics;
+    const uint32_t last_sample_ms = last_sample_ms_.load( std::memory_order_acquire );
+    const uint32_t window = window_.load( std::memory_order_relaxed );
+    if ( ( window & VALID ) == 0 )
+      return statistics;
+    statistics.average = average_.load( std::memory_order_relaxed ) / 256.0f;
+    if ( now_ms - last_sample_ms >= 2 * RSSI_WINDOW_MS )
+      return statistics;
+    statistics.min = static_cast<int8_t>( window & 0xFF );
+    statistics.max = static_cast<int8_t>( ( window >> 8 ) & 0xFF );
+    statistics.valid = true;
+    return statistics;
+  }
+
+private:
+  static constexpr uint32_t VALID = 1 << 16;
+
+  // Shared with the reading tasks
+  std::atomic<int32_t> average_{ 0 };
+  //! Minimum in bits 0-7, maximum in bits 8-15 and the VALID flag.
+  std::atomic<uint32_t> window_{ 0 };
+  std::atomic<uint32_t> last_sample_ms_{ 0 };
+
+  // Only accessed by the sampling task
+  bool has_samples_ = false;
+  bool has_previous_ = false;
+  uint32_t window_start_ms_ = 0;
+  int8_t current_min_ = 0;
+  int8_t current_max_ = 0;
+  int8_t previous_min_ = 0;
+  int8_t previous_max_ = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * Bounded lock-free queue between a single producer and a single consumer, e.g., a radio callback
+ * running on the WiFi or BLE task and the update loop.
+ * Push and pop do not block or allocate. If the queue is full, the pushed element is dropped and
+ * counted, so the producer never waits for the consumer.
+ * @tparam Capacity Maximum number of queued elements, has to be a power of two.
+ */
+template<typename T, size_t Capacity>
+class SPSCQueue
+{
+  static_assert( Capacity > 0 && ( Capacity & ( Capacity - 1 ) ) == 0,
+                 "Capacity has to be a power of two" );
+
+public:
+  //! Called by the producer only. Returns false if the queue is full.
+  bool push( const T &value )
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    if ( head - tail_.load( std::memory_order_acquire ) == Capacity ) {
+      dropped_.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+    buffer_[head % Capacity] = value;
+    head_.store( head + 1, std::memory_order_release );
+    return true;
+  }
+
+  //! Called by the consumer only. Returns false if the queue is empty.
+  bool pop( T &value )
+  {
+    const size_t tail = tail_.load( std::memory_order_relaxed );
+    if ( head_.load( std::memory_order_acquire ) == tail )
+      return false;
+    value = buffer_[tail % Capacity];
+    tail_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  //! Returns the number of elements dropped since the last call because the queue was full.
+  uint32_t takeDropped() { return dropped_.exchange( 0, std::memory_order_relaxed ); }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+private:
+  T buffer_[Capacity] = {};
+  // Free-running counters, the index is taken modulo the capacity
+  std::atomic<size_t> head_{ 0 };
+  std::atomic<size_t> tail_{ 0 };
+  std::atomic<uint32_t> dropped_{ 0 };
+};
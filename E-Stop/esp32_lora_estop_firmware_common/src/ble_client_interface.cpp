@@ -1,5 +1,6 @@
 #include "ble_client_interface.h"
 #include "comm_interface.h"
+#include "estop_log.h"
 #include <elapsedMillis.h>
 
 BLEClientInterface::BLEClientInterface( const std::string &server_name, NimBLEAddress server_address )
@@ -24,6 +25,7 @@ BLEClientInterface::BLEClientInterface( const std::string &server_name, NimBLEAd
 
 void BLEClientInterface::update()
 {
+  processNotifications();
   switch ( state_ ) {
   case ClientState::CONNECTED:
     return;
@@ -46,27 +48,35 @@ void BLEClientInterface::update()
     NimBLERemoteService *service = client_->getService( NimBLEUUID( ESTOP_SERVICE_UUID ) );
     if ( service != nullptr ) {
       service_ = service; // Store the service for later use
+      // Subscribe again, cleared here instead of in onDisconnect which runs on the BLE task
+      characteristics_.clear();
       state_ = ClientState::CONNECTED;
-      Serial.println( "BLE server connected" );
+      ESTOP_LOG_INFO( BLE, BLE_SERVER_CONNECTED );
       return;
     }
     if ( ++get_service_tries_ < 5 )
       return; // Retry up to 5 times
-    Serial.println( "Failed to find service" );
+    ESTOP_LOG_ERROR( BLE, BLE_SERVICE_NOT_FOUND );
     client_->disconnect();
   }
   }
 }
 
-void BLEClientInterface::setProperty( uint8_t id, const std::vector<uint8_t> &data )
+void BLEClientInterface::setProperty( uint8_t id, const PropertyValue &data )
 {
   if ( state_ != ClientState::CONNECTED || service_ == nullptr ) {
     return;
   }
-  service_->setValue( NimBLEUUID( uint16_t( id ) ), data );
+  NimBLERemoteCharacteristic *characteristic =
+      service_->getCharacteristic( NimBLEUUID( uint16_t( id ) ) );
+  if ( characteristic == nullptr ) {
+    return;
+  }
+  // Written from the inline buffer, setValue would copy the data into a temporary NimBLEAttValue
+  characteristic->writeValue( data.data(), data.size() );
 }
 
-void BLEClientInterface::readProperty( uint8_t id, std::vector<uint8_t> &data,
+void BLEClientInterface::readProperty( uint8_t id, PropertyValue &data,
                                        unsigned long &age_ms ) const
 {
   data.clear();
@@ -79,7 +89,7 @@ void BLEClientInterface::readProperty( uint8_t id, std::vector<uint8_t> &data,
   if ( characteristic == nullptr ) {
     return;
   }
-  const auto &info = getOrAddCharacteristicInfo( characteristic->getUUID(), characteristic );
+  const auto &info = getOrAddCharacteristicInfo( id, characteristic );
   data = info.data; // Copy the data from the characteristic info
   age_ms = info.last_message;
 }
@@ -100,48 +110,63 @@ void BLEClientInterface::onResult( const NimBLEAdvertisedDevice *device )
 
 void BLEClientInterface::onConnect( NimBLEClient *client )
 {
-  Serial.println( "onConnect" );
+  ESTOP_LOG_DEBUG( BLE, BLE_CONNECTING );
   state_ = ClientState::CONNECTING;
   scan_->stop();
 }
 
 void BLEClientInterface::onPassKeyEntry( NimBLEConnInfo &conn_info )
 {
-  Serial.printf( "Passkey entry requested.\n" );
+  ESTOP_LOG_DEBUG( BLE, BLE_PASSKEY_REQUESTED );
   NimBLEDevice::injectPassKey( conn_info, ESTOP_BLE_PASSKEY ); // Inject the passkey
 }
 
 void BLEClientInterface::onConnectFail( NimBLEClient *client, int reason )
 {
-  Serial.printf( "Failed to connect to BLE server: %d\n", reason );
+  ESTOP_LOG_WARNING( BLE, BLE_CONNECT_FAILED, reason );
   state_ = ClientState::DISCONNECTED;
 }
 
 void BLEClientInterface::onDisconnect( NimBLEClient *client, int reason )
 {
-  Serial.println( "BLE server disconnected" );
+  ESTOP_LOG_INFO( BLE, BLE_SERVER_DISCONNECTED );
   state_ = ClientState::DISCONNECTED;
   service_ = nullptr;
-  characteristics_.clear();
+}
+
+void BLEClientInterface::processNotifications()
+{
+  Notification notification;
+  while ( notifications_.pop( notification ) ) {
+    for ( auto &info : characteristics_ ) {
+      if ( info.id == notification.id ) {
+        info.data = notification.data;
+        // Assigning an elapsedMillis sets the elapsed time
+        info.last_message = millis() - notification.receive_time_ms;
+        break;
+      }
+    }
+  }
+  if ( const uint32_t dropped = notifications_.takeDropped() )
+    ESTOP_LOG_WARNING( BLE, BLE_MAILBOX_FULL, dropped );
 }
 
 const BLEClientInterface::CharacteristicInfo &
-BLEClientInterface::getOrAddCharacteristicInfo( const NimBLEUUID &uuid,
+BLEClientInterface::getOrAddCharacteristicInfo( uint8_t id,
                                                 NimBLERemoteCharacteristic *characteristic ) const
 {
+  // Runs on the BLE task, only queues the received data
   NimBLERemoteCharacteristic::notify_callback callback =
-      [this, uuid]( NimBLERemoteCharacteristic *pBLERemoteCharacteristic, uint8_t *pData,
-                    size_t length, bool isNotify ) {
-        for ( auto &info : characteristics_ ) {
-          if ( info.id == uuid ) {
-            info.last_message = 0;
-            info.data.assign( pData, pData + length ); // Store the received data
-            break;
-          }
-        }
+      [this, id]( NimBLERemoteCharacteristic *pBLERemoteCharacteristic, uint8_t *pData,
+                  size_t length, bool isNotify ) {
+        Notification notification;
+        notification.receive_time_ms = millis();
+        notification.id = id;
+        notification.data.assign( pData, length );
+        notifications_.push( notification );
       };
   for ( auto &info : characteristics_ ) {
-    if ( info.id == uuid ) {
+    if ( info.id == id ) {
       if ( !info.subscribed ) {
         info.subscribed = characteristic->subscribe( true, callback, true );
       }
@@ -150,7 +175,7 @@ BLEClientInterface::getOrAddCharacteristicInfo( const NimBLEUUID &uuid,
   }
   // Not found, add new characteristic info
   CharacteristicInfo info;
-  info.id = uuid;
+  info.id = id;
   info.subscribed = characteristic->subscribe( true, callback, true );
   characteristics_.emplace_back( info );
   return characteristics_.back();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ble_interface.h"
+#include "spsc_queue.h"
 #include <NimBLEDevice.h>
 #include <elapsedMillis.h>
 
@@ -25,18 +26,27 @@ public:
 
   void update() override;
 
-  void readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const override;
-  void setProperty( uint8_t id, const std::vector<uint8_t> &data ) override;
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override;
+  void setProperty( uint8_t id, const PropertyValue &data ) override;
 
 private:
   enum class ClientState { DISCONNECTED, CONNECTING, CONNECTED };
   struct CharacteristicInfo {
-    std::vector<uint8_t> data;
-    NimBLEUUID id;
+    PropertyValue data;
+    uint8_t id = 0;
     elapsedMillis last_message;
     bool subscribed = false;
   };
 
+  struct Notification {
+    unsigned long receive_time_ms = 0;
+    uint8_t id = 0;
+    PropertyValue data;
+  };
+
+  //! Applies the notifications queued by the BLE task to the characteristic infos.
+  void processNotifications();
+
   // BLEAdvertisedDeviceCallbacks::onResult
   void onResult( const NimBLEAdvertisedDevice *device ) override;
 
@@ -49,8 +59,7 @@ private:
   void onDisconnect( NimBLEClient *client, int reason ) override;
 
   const CharacteristicInfo &
-  getOrAddCharacteristicInfo( const NimBLEUUID &uuid,
-                              NimBLERemoteCharacteristic *characteristic ) const;
+  getOrAddCharacteristicInfo( uint8_t id, NimBLERemoteCharacteristic *characteristic ) const;
 
   const std::string server_name_;
   NimBLEAddress server_address_;
@@ -58,6 +67,9 @@ private:
   NimBLEClient *client_ = nullptr;
   NimBLERemoteService *service_ = nullptr;
   mutable std::vector<CharacteristicInfo> characteristics_;
+  // Filled by the notify callbacks on the BLE task and drained by update, so the characteristic
+  // infos are only accessed from update and readProperty
+  mutable SPSCQueue<Notification, 16> notifications_;
   ClientState state_ = ClientState::DISCONNECTED;
   elapsedMillis scan_duration_;
   int get_service_tries_ = 0;
@@ -1,5 +1,6 @@
 #include "ble_server_interface.h"
 #include "comm_interface.h"
+#include "estop_log.h"
 
 BLEServerInterface::BLEServerInterface( const std::string &name )
 {
@@ -57,7 +58,7 @@ int8_t BLEServerInterface::getRSSI( const NimBLEAddress &address ) const
     if ( conn_info.getAddress() == address ) {
       int8_t rssi = 0;
       if ( ble_gap_conn_rssi( conn_info.getConnHandle(), &rssi ) != 0 ) {
-        Serial.printf( "Failed to read RSSI for %s\n", address.toString().c_str() );
+        ESTOP_LOG_WARNING( BLE, BLE_RSSI_READ_FAILED, LOG_ADDRESS_ARGS( address ) );
         return 0.0f;
       }
       return static_cast<float>( rssi );
@@ -77,47 +78,47 @@ void BLEServerInterface::update()
   }
 }
 
-void BLEServerInterface::setProperty( uint8_t id, const std::vector<uint8_t> &data )
+void BLEServerInterface::setProperty( uint8_t id, const PropertyValue &data )
 {
   if ( service_ == nullptr ) {
-    Serial.println( "Not connected or characteristic not found" );
+    ESTOP_LOG_WARNING( BLE, BLE_NOT_CONNECTED );
     return;
   }
 
   NimBLECharacteristic *characteristic = service_->getCharacteristic( NimBLEUUID( uint16_t( id ) ) );
   if ( characteristic == nullptr ) {
-    Serial.printf( "Characteristic %d not found\n", id );
+    ESTOP_LOG_WARNING( BLE, BLE_CHARACTERISTIC_NOT_FOUND, id );
     return;
   }
-  characteristic->setValue( data );
+  characteristic->setValue( data.data(), data.size() );
   characteristic->notify();
 }
 
-void BLEServerInterface::readProperty( uint8_t id, std::vector<uint8_t> &data,
+void BLEServerInterface::readProperty( uint8_t id, PropertyValue &data,
                                        unsigned long &age_ms ) const
 {
   if ( service_ == nullptr ) {
-    Serial.println( "Not connected or characteristic not found" );
+    ESTOP_LOG_WARNING( BLE, BLE_NOT_CONNECTED );
     return;
   }
   NimBLECharacteristic *characteristic = service_->getCharacteristic( NimBLEUUID( uint16_t( id ) ) );
   if ( characteristic == nullptr ) {
-    Serial.printf( "Characteristic %d not found\n", id );
+    ESTOP_LOG_WARNING( BLE, BLE_CHARACTERISTIC_NOT_FOUND, id );
     return;
   }
-  NimBLEAttValue value = characteristic->getValue();
-  data.assign( value.begin(), value.end() );
+  // Read by reference, a copy of the NimBLEAttValue would allocate
+  const NimBLEAttValue &value = characteristic->getValue();
+  data.assign( value.data(), value.size() );
   time_t now = time( nullptr );
   age_ms = now < value.getTimeStamp() ? 0 : now - value.getTimeStamp();
 }
 
 void BLEServerInterface::onConnect( NimBLEServer *server, NimBLEConnInfo &conn_info )
 {
-  Serial.printf( "BLE client (%s) connected\n", conn_info.getAddress().toString().c_str() );
+  ESTOP_LOG_INFO( BLE, BLE_CLIENT_CONNECTED, LOG_ADDRESS_ARGS( conn_info.getAddress() ) );
   auto it = std::find( BLE_WHITELIST.begin(), BLE_WHITELIST.end(), conn_info.getAddress() );
   if ( it == BLE_WHITELIST.end() ) {
-    Serial.printf( "Connected to unexpected address: %s\n",
-                   conn_info.getAddress().toString().c_str() );
+    ESTOP_LOG_WARNING( BLE, BLE_UNEXPECTED_ADDRESS, LOG_ADDRESS_ARGS( conn_info.getAddress() ) );
     server->disconnect( conn_info.getConnHandle() );
     return;
   }
@@ -125,7 +126,7 @@ void BLEServerInterface::onConnect( NimBLEServer *server, NimBLEConnInfo &conn_i
       connected_clients_.begin(), connected_clients_.end(),
       [&]( const NimBLEConnInfo &info ) { return info.getAddress() == conn_info.getAddress(); } );
   if ( cit != connected_clients_.end() ) {
-    Serial.println( "Client already in connected clients list" );
+    ESTOP_LOG_DEBUG( BLE, BLE_CLIENT_ALREADY_CONNECTED );
     return;
   }
   connected_clients_.push_back( conn_info );
@@ -133,7 +134,7 @@ void BLEServerInterface::onConnect( NimBLEServer *server, NimBLEConnInfo &conn_i
 
 void BLEServerInterface::onDisconnect( NimBLEServer *server, NimBLEConnInfo &conn_info, int reason )
 {
-  Serial.printf( "BLE client (%s) disconnected\n", conn_info.getAddress().toString().c_str() );
+  ESTOP_LOG_INFO( BLE, BLE_CLIENT_DISCONNECTED, LOG_ADDRESS_ARGS( conn_info.getAddress() ) );
   NimBLEClient *client = server->getClient( conn_info );
   auto it = std::find_if(
       connected_clients_.begin(), connected_clients_.end(),
@@ -16,8 +16,8 @@ public:
 
   void update() override;
 
-  void setProperty( uint8_t id, const std::vector<uint8_t> &data ) override;
-  void readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const override;
+  void setProperty( uint8_t id, const PropertyValue &data ) override;
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override;
 
 private:
   void onConnect( NimBLEServer *server, NimBLEConnInfo &conn_info ) override;
@@ -2,7 +2,9 @@
 #include "ble_client_interface.h"
 #include "ble_server_interface.h"
 #include "esp_now_interface.h"
+#include "estop_log.h"
 
+#include <array>
 #include <elapsedMillis.h>
 
 inline uint8_t to_uint8_t( bool value ) { return value ? 0xff : 0; }
@@ -14,73 +16,45 @@ public:
 
   void update()
   {
-    if ( ble_interface != nullptr ) {
-      ble_interface->update();
+    for ( TransportInterface *transport : transports ) {
+      transport->update();
     }
-    esp_now_interface.update();
 
     updateDeadmanStates();
 
     if ( last_status_update_time > 500 ) {
       last_status_update_time = 0;
-      if ( ble_interface != nullptr ) {
-        status.ble_state = ble_interface->getCommState( peer_ble_address );
-        status.ble_rssi = ble_interface->getRSSI( peer_ble_address );
-      } else {
-        status.ble_state = CommState::DISCONNECTED;
-        status.ble_rssi = 0.0f;
-      }
+      status.ble_state = ble_transport.getCommState();
+      status.ble_rssi = ble_transport.getRSSI();
       status.esp_now_state = esp_now_interface.getCommState();
       status.esp_now_rssi = esp_now_interface.getRSSI();
       status.last_received_message_age_ms = last_transmit;
     }
   }
 
-  void setProperty( uint8_t id, const std::vector<uint8_t> &data )
+  void setProperty( uint8_t id, const PropertyValue &data )
   {
-    if ( ble_interface != nullptr ) {
-      ble_interface->setProperty( id, data );
-    }
-    esp_now_interface.setProperty( id, data );
-  }
-
-  void updateStateIfNewer( unsigned long &most_recent_age, bool &state,
-                           const std::vector<uint8_t> &data, unsigned long age_ms )
-  {
-    if ( age_ms < most_recent_age ) {
-      most_recent_age = age_ms;
-      state = readState( data );
+    for ( TransportInterface *transport : transports ) {
+      transport->setProperty( id, data );
     }
   }
 
   void updateDeadmanStates()
   {
-    unsigned long most_recent_age_active = ULONG_MAX;
-    unsigned long most_recent_age_triggered = ULONG_MAX;
-    bool is_active_state = is_active_;
-    bool is_triggered_state = is_triggered_;
-    if ( ble_interface != nullptr &&
-         ble_interface->getCommState( peer_ble_address ) == CommState::CONNECTED ) {
-      unsigned long age_ms;
-      ble_interface->readProperty( COMM_PROPERTY_ID_DEADMAN_ACTIVE, data, age_ms );
-      updateStateIfNewer( most_recent_age_active, is_active_state, data, age_ms );
-      ble_interface->readProperty( COMM_PROPERTY_ID_DEADMAN_TRIGGERED, data, age_ms );
-      updateStateIfNewer( most_recent_age_triggered, is_triggered_state, data, age_ms );
-    }
-    if ( esp_now_interface.getCommState() == CommState::CONNECTED ) {
-      unsigned long age_ms;
-      esp_now_interface.readProperty( COMM_PROPERTY_ID_DEADMAN_ACTIVE, data, age_ms );
-      updateStateIfNewer( most_recent_age_active, is_active_state, data, age_ms );
-      esp_now_interface.readProperty( COMM_PROPERTY_ID_DEADMAN_TRIGGERED, data, age_ms );
-      updateStateIfNewer( most_recent_age_triggered, is_triggered_state, data, age_ms );
-    }
-    is_triggered_ = most_recent_age_triggered > 300 ? true : is_triggered_state;
-    is_active_ = is_active_state;
+    unsigned long most_recent_age_active;
+    unsigned long most_recent_age_triggered;
+    if ( readNewestProperty( transports.data(), transports.size(), COMM_PROPERTY_ID_DEADMAN_ACTIVE,
+                             data, most_recent_age_active ) != nullptr )
+      is_active_ = readState( data );
+    readNewestProperty( transports.data(), transports.size(), COMM_PROPERTY_ID_DEADMAN_TRIGGERED,
+                        data, most_recent_age_triggered );
+    // Triggered if not received for too long, the age is ULONG_MAX if it was never received
+    is_triggered_ = most_recent_age_triggered > 300 || readState( data );
     last_transmit = std::min<unsigned long>( most_recent_age_active, last_transmit );
     last_transmit = std::min<unsigned long>( most_recent_age_triggered, last_transmit );
   }
 
-  bool readState( const std::vector<uint8_t> &data ) const { return data.empty() || data[0] != 0; }
+  bool readState( const PropertyValue &data ) const { return data.empty() || data[0] != 0; }
 
   CommStatus status;
   elapsedMillis last_status_update_time;
@@ -91,7 +65,9 @@ public:
   ESPNowInterface esp_now_interface;
   BLEInterface *ble_interface;
   NimBLEAddress peer_ble_address;
-  std::vector<uint8_t> data;
+  BLETransport ble_transport;
+  std::array<TransportInterface *, 2> transports;
+  PropertyValue data;
   elapsedMillis last_transmit = 1000000;
 };
 
@@ -111,11 +87,10 @@ void DeadmanCommInterface::initialize( const CommPeerInfo &peer_info )
   if ( impl_ != nullptr )
     return;
   // Setup BLE
-  Serial.println( "Initializing BLE in client mode..." );
+  ESTOP_LOG_INFO( DEADMAN, BLE_INIT_CLIENT );
   initialize( new BLEClientInterface( ESTOP_BLE_NAME, NimBLEAddress( peer_info.ble_mac, 0 ) ),
               peer_info );
-  Serial.print( "BLE Device initialized with address: " );
-  Serial.println( BLEDevice::getAddress().toString().c_str() );
+  ESTOP_LOG_INFO( DEADMAN, BLE_DEVICE_ADDRESS, LOG_ADDRESS_ARGS( BLEDevice::getAddress() ) );
 }
 
 DeadmanCommInterface::~DeadmanCommInterface() = default;
@@ -151,6 +126,7 @@ bool DeadmanCommInterface::isTriggered() const
 
 DeadmanCommInterface::Impl::Impl( BLEInterface *ble_interface, const CommPeerInfo peer_info )
     : esp_now_interface( peer_info.esp_now_mac ), ble_interface( ble_interface ),
-      peer_ble_address( peer_info.ble_mac, 0 )
+      peer_ble_address( peer_info.ble_mac, 0 ), ble_transport( ble_interface, peer_ble_address ),
+      transports{ &ble_transport, &esp_now_interface }
 {
 }
@@ -1,14 +1,21 @@
 #include "esp_now_interface.h"
+#include "estop_log.h"
+#include "peer_table.h"
+#include "rssi_filter.h"
+#include "spsc_queue.h"
 #include <WiFi.h>
+#include <atomic>
 #include <elapsedMillis.h>
 #include <esp_now.h>
 #include <esp_wifi.h>
 #include <memory>
 
+static constexpr uint8_t ESP_NOW_ACK_ID = 0xFF;
+
 class ESPNowInterface::ESPNowConnection
 {
 public:
-  ESPNowConnection( const esp_now_peer_info_t &peer_info ) : peer_info( peer_info ), rssi( 0 ) { }
+  ESPNowConnection( const esp_now_peer_info_t &peer_info ) : peer_info( peer_info ) { }
 
   void onSent( const uint8_t *mac_addr, esp_now_send_status_t status )
   {
@@ -19,21 +26,33 @@ public:
     }
   }
 
+  //! Called from the WiFi task, only queues the packet.
   void onReceived( const uint8_t *mac_addr, const uint8_t *data, int len );
 
-  void writeProperty( uint8_t id, const std::vector<uint8_t> &data );
+  //! Called from update, applies the queued packets and acknowledges them.
+  void processReceivedPackets();
+
+  void writeProperty( uint8_t id, const PropertyValue &data );
+
+  struct ReceivedPacket {
+    unsigned long receive_time_ms = 0;
+    uint8_t id = ESP_NOW_ACK_ID;
+    PropertyValue data;
+  };
 
   esp_now_peer_info_t peer_info;
   elapsedMillis last_received_time = 100000;
-  unsigned long transmission_success_count = 0;
-  unsigned long transmission_failure_count = 0;
-  int8_t rssi;
+  std::atomic<unsigned long> transmission_success_count{ 0 };
+  std::atomic<unsigned long> transmission_failure_count{ 0 };
+  // Sampled by the promiscuous callback on the WiFi task
+  RSSIFilter rssi;
   struct Property {
-    std::vector<uint8_t> data;
+    PropertyValue data;
     elapsedMillis age_ms = 100000;
   };
   std::array<Property, NUM_COMM_PROPERTIES> properties;
-  std::vector<uint8_t> send_buffer;
+  // Filled by the WiFi task and drained by update, so properties are only accessed from update
+  SPSCQueue<ReceivedPacket, 16> received_packets;
 };
 
 class ESPNowInterface::ESPNowManager
@@ -48,61 +67,55 @@ public:
 
   void onSent( const uint8_t *mac_addr, esp_now_send_status_t status )
   {
-    for ( auto &connection : connections ) {
-      if ( memcmp( connection->peer_info.peer_addr, mac_addr, 6 ) == 0 ) {
-        connection->onSent( mac_addr, status );
-        return;
-      }
-    }
+    if ( ESPNowConnection *connection = peers.find( mac_addr ) )
+      connection->onSent( mac_addr, status );
   }
 
   void onReceived( const uint8_t *mac_addr, const uint8_t *data, int len )
   {
-    for ( auto &connection : connections ) {
-      if ( memcmp( connection->peer_info.peer_addr, mac_addr, 6 ) == 0 ) {
-        connection->onReceived( mac_addr, data, len );
-        return;
-      }
-    }
+    if ( ESPNowConnection *connection = peers.find( mac_addr ) )
+      connection->onReceived( mac_addr, data, len );
   }
 
-  void updateRSSI( const uint8_t sender_mac[6], int rssi )
+  void updateRSSI( const uint8_t sender_mac[6], int8_t rssi )
   {
-    for ( auto &connection : connections ) {
-      if ( memcmp( connection->peer_info.peer_addr, sender_mac, 6 ) == 0 ) {
-        connection->rssi = rssi;
-        return;
-      }
-    }
+    if ( ESPNowConnection *connection = peers.find( sender_mac ) )
+      connection->rssi.add( rssi, millis() );
   }
 
-  std::shared_ptr<ESPNowInterface::ESPNowConnection> addConnection( const uint8_t peer_mac[6] )
+  std::unique_ptr<ESPNowInterface::ESPNowConnection> addConnection( const uint8_t peer_mac[6] )
   {
     esp_now_peer_info_t peer_info = {};
     std::copy( peer_mac, peer_mac + 6, peer_info.peer_addr );
     peer_info.channel = 0;
     peer_info.encrypt = false;
+    auto connection = std::make_unique<ESPNowInterface::ESPNowConnection>( peer_info );
+    // Added to the table first, so the callbacks find the connection once the peer is added
+    if ( !peers.insert( peer_mac, connection.get() ) ) {
+      ESTOP_LOG_ERROR( ESP_NOW, ESP_NOW_PEER_TABLE_FULL, PeerTable<ESPNowConnection>::MAX_PEERS );
+      return connection;
+    }
 
     // Add peer
     if ( esp_now_add_peer( &peer_info ) != ESP_OK ) {
-      Serial.println( "Failed to add ESP-NOW peer" );
+      ESTOP_LOG_ERROR( ESP_NOW, ESP_NOW_ADD_PEER_FAILED );
     } else {
-      Serial.println( "ESP-NOW peer added successfully" );
+      ESTOP_LOG_INFO( ESP_NOW, ESP_NOW_PEER_ADDED );
     }
-    auto connection = std::make_shared<ESPNowInterface::ESPNowConnection>( peer_info );
-    connections.push_back( connection );
     return connection;
   }
 
-  void removeConnection( std::shared_ptr<ESPNowInterface::ESPNowConnection> connection )
+  void removeConnection( const ESPNowInterface::ESPNowConnection &connection )
   {
-    esp_now_del_peer( connection->peer_info.peer_addr );
-    connections.erase( std::remove( connections.begin(), connections.end(), connection ),
-                       connections.end() );
+    if ( peers.find( connection.peer_info.peer_addr ) != &connection )
+      return; // Not added, e.g., because the table was full
+    esp_now_del_peer( connection.peer_info.peer_addr );
+    peers.remove( connection.peer_info.peer_addr );
   }
 
   esp_err_t state = ESP_ERR_ESPNOW_NOT_INIT;
-  std::vector<std::shared_ptr<ESPNowInterface::ESPNowConnection>> connections;
+  // Looked up in the WiFi callbacks, the connections are owned by the ESPNowInterfaces
+  PeerTable<ESPNowInterface::ESPNowConnection> peers;
 };
 
 ESPNowInterface::ESPNowManager *ESPNowInterface::manager_ = nullptr;
@@ -119,23 +132,28 @@ ESPNowInterface::~ESPNowInterface()
 {
   // Note: We do not delete the manager_ here as it may be shared among multiple instances.
   // Proper cleanup of the manager_ should be handled at program termination if needed.
-  manager_->removeConnection( connection_ );
+  manager_->removeConnection( *connection_ );
 }
 
-void ESPNowInterface::update() { /* Nothing to do */ }
+void ESPNowInterface::update() { connection_->processReceivedPackets(); }
 
 CommState ESPNowInterface::getCommState() const
 {
   if ( manager_->state != ESP_OK ) {
     return CommState::ERROR;
   }
-  if ( connection_->last_received_time < 500 ) {
+  if ( connection_->last_received_time < COMM_CONNECTION_TIMEOUT_MS ) {
     return CommState::CONNECTED;
   }
   return CommState::DISCONNECTED;
 }
 
-int8_t ESPNowInterface::getRSSI() const { return connection_->rssi; }
+float ESPNowInterface::getRSSI() const { return connection_->rssi.get( millis() ).average; }
+
+RSSIStatistics ESPNowInterface::getRSSIStatistics() const
+{
+  return connection_->rssi.get( millis() );
+}
 
 unsigned long ESPNowInterface::getLastReceivedMessageAge() const
 {
@@ -158,7 +176,7 @@ void ESPNowInterface::resetTransmissionStats()
   connection_->transmission_failure_count = 0;
 }
 
-void ESPNowInterface::readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const
+void ESPNowInterface::readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const
 {
   if ( id >= connection_->properties.size() ) {
     data.clear();
@@ -170,7 +188,7 @@ void ESPNowInterface::readProperty( uint8_t id, std::vector<uint8_t> &data, unsi
   age_ms = property.age_ms;
 }
 
-void ESPNowInterface::setProperty( uint8_t id, const std::vector<uint8_t> &data )
+void ESPNowInterface::setProperty( uint8_t id, const PropertyValue &data )
 {
   connection_->writeProperty( id, data );
 }
@@ -185,6 +203,7 @@ IRAM_ATTR void onReceivedCallback( const uint8_t *mac_addr, const uint8_t *data,
 }
 
 // Structures for retrieving packet data: RSSI, etc
+// Header of management frames, they have no fourth address
 typedef struct {
   unsigned frame_ctrl : 16;
   unsigned duration_id : 16;
@@ -192,25 +211,38 @@ typedef struct {
   uint8_t addr2[6]; /* sender address */
   uint8_t addr3[6]; /* filtering address */
   unsigned sequence_ctrl : 16;
-  uint8_t addr4[6]; /* optional */
 } wifi_ieee80211_mac_hdr_t;
 
+// ESP-NOW packets are vendor specific action frames with the Espressif OUI
 typedef struct {
   wifi_ieee80211_mac_hdr_t hdr;
+  uint8_t category;
+  uint8_t oui[3];
   uint8_t payload[0]; /* network data ended with 4 bytes csum (CRC32) */
-} wifi_ieee80211_packet_t;
+} wifi_ieee80211_action_frame_t;
+
+static constexpr unsigned WIFI_FRAME_CTRL_TYPE_SUBTYPE_MASK = 0xFC;
+static constexpr unsigned WIFI_FRAME_CTRL_ACTION = 0xD0;
+static constexpr uint8_t WIFI_ACTION_CATEGORY_VENDOR_SPECIFIC = 127;
+static constexpr uint8_t ESPRESSIF_OUI[3] = { 0x18, 0xFE, 0x34 };
 
 IRAM_ATTR void promiscuous_rx_cb( void *buf, wifi_promiscuous_pkt_type_t type )
 {
-  // All espnow traffic uses action frames which are a subtype of the mgmnt frames so filter out everything else.
+  // Other types are already filtered out by esp_wifi_set_promiscuous_filter
   if ( type != WIFI_PKT_MGMT )
     return;
 
   const wifi_promiscuous_pkt_t *ppkt = (wifi_promiscuous_pkt_t *)buf;
-  const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)ppkt->payload;
-  const wifi_ieee80211_mac_hdr_t *hdr = &ipkt->hdr;
+  if ( ppkt->rx_ctrl.sig_len < sizeof( wifi_ieee80211_action_frame_t ) )
+    return;
+  const auto *frame = (const wifi_ieee80211_action_frame_t *)ppkt->payload;
+  // Beacons, probes and other management frames are rejected before the peer lookup
+  if ( ( frame->hdr.frame_ctrl & WIFI_FRAME_CTRL_TYPE_SUBTYPE_MASK ) != WIFI_FRAME_CTRL_ACTION ||
+       frame->category != WIFI_ACTION_CATEGORY_VENDOR_SPECIFIC ||
+       memcmp( frame->oui, ESPRESSIF_OUI, sizeof( ESPRESSIF_OUI ) ) != 0 )
+    return;
 
-  ESPNowInterface::manager_->updateRSSI( hdr->addr2, ppkt->rx_ctrl.rssi );
+  ESPNowInterface::manager_->updateRSSI( frame->hdr.addr2, ppkt->rx_ctrl.rssi );
 }
 
 ESPNowInterface::ESPNowManager::ESPNowManager()
@@ -228,6 +260,10 @@ ESPNowInterface::ESPNowManager::ESPNowManager()
   esp_now_register_recv_cb( onReceivedCallback );
 
   // Enable promiscuous mode to capture all ESP-NOW traffic and get RSSI
+  // Only management frames are passed to the callback, ESP-NOW uses action frames
+  wifi_promiscuous_filter_t filter = {};
+  filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+  esp_wifi_set_promiscuous_filter( &filter );
   esp_wifi_set_promiscuous( true );
   esp_wifi_set_promiscuous_rx_cb( promiscuous_rx_cb );
 }
@@ -239,35 +275,51 @@ void ESPNowInterface::ESPNowConnection::onReceived( const uint8_t *mac_addr, con
     return;
   }
   const uint8_t index = data[0];
-  if ( index == 0xFF ) {
-    // Acknowledgment packet, ignore
-    last_received_time = 0;
-    return;
-  }
-  if ( index < 0 || index >= properties.size() ) {
-    Serial.println( "Received packet with invalid property index" );
+  if ( index != ESP_NOW_ACK_ID && index >= properties.size() ) {
+    ESTOP_LOG_WARNING( ESP_NOW, ESP_NOW_INVALID_PROPERTY );
     return;
   }
-  properties[index].data.assign( data + 1, data + len );
-  properties[index].age_ms = 0; // Reset age on valid packet
-  last_received_time = 0;
-  // Acknowledge the received packet
-  uint8_t ack_package[2] = { uint8_t( 0xFF ), index };
-  esp_err_t result = esp_now_send( mac_addr, ack_package, 2 );
-  if ( result != ESP_OK ) {
-    transmission_failure_count++;
+  ReceivedPacket packet;
+  packet.receive_time_ms = millis();
+  packet.id = index;
+  // Acknowledgment packets only update the receive time
+  if ( index != ESP_NOW_ACK_ID )
+    packet.data.assign( data + 1, len - 1 );
+  received_packets.push( packet );
+}
+
+void ESPNowInterface::ESPNowConnection::processReceivedPackets()
+{
+  ReceivedPacket packet;
+  while ( received_packets.pop( packet ) ) {
+    // Assigning an elapsedMillis sets the elapsed time
+    const unsigned long age_ms = millis() - packet.receive_time_ms;
+    last_received_time = age_ms;
+    if ( packet.id == ESP_NOW_ACK_ID )
+      continue;
+    properties[packet.id].data = packet.data;
+    properties[packet.id].age_ms = age_ms;
+    // Acknowledge the received packet
+    uint8_t ack_package[2] = { ESP_NOW_ACK_ID, packet.id };
+    esp_err_t result = esp_now_send( peer_info.peer_addr, ack_package, 2 );
+    if ( result != ESP_OK ) {
+      transmission_failure_count++;
+    }
   }
+  if ( const uint32_t dropped = received_packets.takeDropped() )
+    ESTOP_LOG_WARNING( ESP_NOW, ESP_NOW_MAILBOX_FULL, dropped );
 }
 
-void ESPNowInterface::ESPNowConnection::writeProperty( uint8_t id, const std::vector<uint8_t> &data )
+void ESPNowInterface::ESPNowConnection::writeProperty( uint8_t id, const PropertyValue &data )
 {
   if ( ESPNowInterface::manager_->state != ESP_OK )
     return;
-  send_buffer.clear();
-  send_buffer.push_back( id );
-  send_buffer.insert( send_buffer.end(), data.begin(), data.end() );
+  // esp_now_send copies the packet, so it can be assembled on the stack
+  uint8_t packet[1 + MAX_PROPERTY_SIZE];
+  packet[0] = id;
+  std::copy( data.begin(), data.end(), packet + 1 );
 
-  esp_err_t result = esp_now_send( peer_info.peer_addr, send_buffer.data(), send_buffer.size() );
+  esp_err_t result = esp_now_send( peer_info.peer_addr, packet, 1 + data.size() );
   if ( result != ESP_OK ) {
     transmission_failure_count++;
   }
@@ -1,22 +1,27 @@
 #pragma once
 
-#include "comm_interface.h"
+#include "comm_transport.h"
+#include "rssi_filter.h"
 
 #include <memory>
-#include <vector>
 
-class ESPNowInterface
+class ESPNowInterface : public TransportInterface
 {
 public:
   ESPNowInterface( const uint8_t peer_mac[6] );
 
-  ~ESPNowInterface();
+  ~ESPNowInterface() override;
 
-  void update();
+  CommTransport getTransportType() const override { return CommTransport::ESP_NOW; }
 
-  CommState getCommState() const;
+  void update() override;
 
-  int8_t getRSSI() const;
+  CommState getCommState() const override;
+
+  //! Average RSSI of the ESP-NOW packets of the peer.
+  float getRSSI() const override;
+
+  RSSIStatistics getRSSIStatistics() const;
 
   unsigned long getLastReceivedMessageAge() const;
 
@@ -32,13 +37,13 @@ public:
            id == COMM_PROPERTY_ID_BATTERY;
   }
 
-  void readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const;
-  void setProperty( uint8_t id, const std::vector<uint8_t> &data );
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override;
+  void setProperty( uint8_t id, const PropertyValue &data ) override;
 
   class ESPNowManager;
   class ESPNowConnection;
   static ESPNowManager *manager_;
 
 private:
-  std::shared_ptr<ESPNowConnection> connection_;
+  std::unique_ptr<ESPNowConnection> connection_;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "estop_log.h"
+
+#include <Arduino.h>
+
+namespace
+{
+void printLogRecord( const LogRecord &record )
+{
+  char text[160];
+  formatLogRecord( record, text, sizeof( text ) );
+  Serial.printf( "[%s] [%s] %s\n", logLevelName( record.level ),
+                 logSubsystemName( record.subsystem ), text );
+}
+
+struct RateLimit {
+  unsigned long window_start = 0;
+  uint8_t count = 0;
+  uint16_t suppressed = 0;
+};
+
+LogSink log_sink = &printLogRecord;
+RateLimit rate_limits[static_cast<size_t>( LogMessage::COUNT )];
+// Messages are logged from the main loop and from BLE and ESP-NOW callbacks on other tasks
+portMUX_TYPE rate_limit_mux = portMUX_INITIALIZER_UNLOCKED;
+} // namespace
+
+void setLogSink( LogSink sink ) { log_sink = sink == nullptr ? &printLogRecord : sink; }
+
+void logMessage( LogLevel level, LogSubsystem subsystem, LogMessage message, int32_t arg0,
+                 int32_t arg1 )
+{
+  const auto index = static_cast<size_t>( message );
+  if ( index >= static_cast<size_t>( LogMessage::COUNT ) )
+    return;
+  LogRecord record;
+  record.level = level;
+  record.subsystem = subsystem;
+  record.message = message;
+  record.args = { arg0, arg1 };
+
+  const unsigned long now = millis();
+  portENTER_CRITICAL( &rate_limit_mux );
+  RateLimit &limit = rate_limits[index];
+  if ( now - limit.window_start >= ESTOP_LOG_WINDOW_MS ) {
+    limit.window_start = now;
+    limit.count = 0;
+  }
+  const bool passed = limit.count < ESTOP_LOG_BURST;
+  if ( passed ) {
+    ++limit.count;
+    record.suppressed = limit.suppressed;
+    limit.suppressed = 0;
+  } else if ( limit.suppressed < UINT16_MAX ) {
+    ++limit.suppressed;
+  }
+  portEXIT_CRITICAL( &rate_limit_mux );
+
+  if ( passed )
+    log_sink( record );
+}
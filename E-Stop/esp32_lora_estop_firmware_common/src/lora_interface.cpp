@@ -1,107 +1,302 @@
 #include "lora_interface.h"
+#include "estop_log.h"
+#include "lora_duty_cycle.h"
+#include "lora_frame.h"
+#include "lora_link_adaptation.h"
+#include "spsc_queue.h"
 
 #include <RadioLib.h>
 #define RADIO_BOARD_AUTO
 #include <RadioBoards.h>
 
+#include <algorithm>
+#include <atomic>
 #include <elapsedMillis.h>
+#include <esp_timer.h>
 
+//! Above the loop task, so the radio is served as soon as the interrupt fired.
+static constexpr UBaseType_t LORA_TASK_PRIORITY = 10;
+//! The task also wakes up this often to check the timeouts of the link adaptation.
+static constexpr uint32_t LORA_TASK_POLL_MS = 100;
+//! A transmission is aborted if the radio did not signal completion this long after its airtime.
+static constexpr uint32_t LORA_TRANSMIT_TIMEOUT_MARGIN_MS = 100;
+
+/*!
+ * The radio is only accessed by a dedicated task. The DIO1 interrupt takes the time of the packet
+ * and notifies the task, which reads the packet or starts the next transmission right away. A
+ * one-shot timer notifies the server task when the duty cycle allows the next packet.
+ * The state to send is shared with the task under state_mux, received frames are passed to the loop
+ * in a queue.
+ */
 class LoraInterface::Impl
 {
 public:
   Impl( bool is_server );
 
-  void update()
+  //! Starts the task and the interrupt. Called once LoraInterface::impl_ points to this object.
+  void start();
+
+  static void runTask( void *arg );
+
+  static void onTransmitTimer( void *arg );
+
+  void runServer();
+
+  void runClient();
+
+  void updateServerConfig();
+
+  //! Notifies the task after the given time, replacing an earlier notification.
+  void notifyAfter( uint32_t delay_ms )
   {
-    if ( is_server ) {
-      updateServer();
-    } else {
-      updateClient();
-    }
+    esp_timer_stop( transmit_timer );
+    esp_timer_start_once( transmit_timer, static_cast<uint64_t>( delay_ms ) * 1000 );
   }
 
-  void updateServer();
+  //! Switches the radio to one of LORA_CONFIGS, the client continues receiving.
+  void applyConfig( uint8_t index )
+  {
+    const LoraConfig &lora_config = LORA_CONFIGS[index];
+    radio.standby();
+    int result = radio.setBandwidth( lora_config.bandwidth_khz );
+    if ( result == RADIOLIB_ERR_NONE )
+      result = radio.setSpreadingFactor( lora_config.spreading_factor );
+    if ( result != RADIOLIB_ERR_NONE ) {
+      ESTOP_LOG_ERROR( LORA, LORA_CONFIG_ERROR, result );
+      return;
+    }
+    config = index;
+    config_time = millis();
+    time_on_air_us = radio.getTimeOnAir( LORA_FRAME_SIZE );
+    ESTOP_LOG_INFO( LORA, LORA_CONFIG_CHANGED, lora_config.spreading_factor,
+                    static_cast<int>( lora_config.bandwidth_khz ) );
+    if ( !is_server ) {
+      adaptation.setConfig( index, config_time );
+      current_config = index;
+      radio_status = radio.startReceive();
+    }
+  }
 
-  void updateClient();
+  //! Sends the next packets with the switch bit, the radio is switched after the last one.
+  void announceConfig( uint8_t index )
+  {
+    next_config = index;
+    switch_packets = LORA_SWITCH_PACKETS;
+    switch_pending = true;
+  }
 
-  void sendData( const std::vector<uint8_t> &data )
+  void sendData( const uint8_t *data, size_t size )
   {
     operation_done = false;
-    radio_status = radio.startTransmit( data.data(), data.size() );
-    last_send_time = 0;
+    radio_status = radio.startTransmit( data, size );
+    send_time = millis();
     if ( radio_status != RADIOLIB_ERR_NONE ) {
-      static elapsedMillis last_error_print = 5000;
-      if ( last_error_print > 2000 ) {
-        last_error_print = 0;
-        Serial.printf( "Radio transmit error: %d\n", radio_status );
-      }
+      ESTOP_LOG_ERROR( LORA, LORA_TRANSMIT_ERROR, radio_status.load() );
       operation_done = true;
       return;
     }
+    // Accounted once started, a packet that times out may still have been on air
+    duty_cycle.addTransmission( time_on_air_us, send_time );
   }
 
-  void setProperty( uint8_t id, const std::vector<uint8_t> &data )
+  //! The properties are packed into the frame that is sent with every packet, see lora_frame.h.
+  void setProperty( uint8_t id, const PropertyValue &data )
   {
-    if ( id == COMM_PROPERTY_ID_ESTOP ) {
-      estop_data.clear();
-      estop_data.push_back( id ); // Store the property ID as the first byte
-      estop_data.insert( estop_data.end(), data.begin(), data.end() );
-    } else if ( id == COMM_PROPERTY_ID_SOFT_ESTOP ) {
-      soft_estop_data.clear();
-      soft_estop_data.push_back( id ); // Store the property ID as the first byte
-      soft_estop_data.insert( soft_estop_data.end(), data.begin(), data.end() );
+    bool changed = false;
+    portENTER_CRITICAL( &state_mux );
+    if ( id == COMM_PROPERTY_ID_ESTOP && data.size() >= 2 ) {
+      // Only the state and the sequence of the trace are sent
+      changed = !has_estop || send_frame.estop_active != ( data[0] != 0 );
+      send_frame.estop_active = data[0] != 0;
+      send_frame.estop_sequence = data[1];
+      has_estop = true;
+    } else if ( id == COMM_PROPERTY_ID_SOFT_ESTOP && data.size() >= 2 ) {
+      changed = send_frame.soft_estop_active != ( data[0] != 0 );
+      send_frame.soft_estop_active = data[0] != 0;
+      send_frame.soft_estop_sequence = data[1];
+    } else if ( id == COMM_PROPERTY_ID_BATTERY && !data.empty() ) {
+      send_frame.battery_valid = true;
+      send_frame.battery_level = data[0];
     }
     // Other property IDs are ignored due to bandwidth limitations
+    portEXIT_CRITICAL( &state_mux );
+    // Changes are sent as soon as the radio is free instead of waiting for the timer
+    if ( changed && task != nullptr )
+      xTaskNotifyGive( task );
   }
 
-  void readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const
   {
     data.clear();
-    age_ms = ULONG_MAX; // Invalid property ID
+    age_ms = ULONG_MAX; // Invalid property ID or no frame received
+    if ( !has_received_frame )
+      return;
     if ( id == COMM_PROPERTY_ID_ESTOP ) {
-      if ( !estop_data.empty() ) {
-        data.assign( estop_data.begin() + 1, estop_data.end() ); // Skip the first byte (property ID)
-        age_ms = estop_data_age;
-      }
+      data = { static_cast<uint8_t>( received_frame.estop_active ? 0xff : 0 ),
+               received_frame.estop_sequence };
     } else if ( id == COMM_PROPERTY_ID_SOFT_ESTOP ) {
-      if ( !soft_estop_data.empty() ) {
-        data.assign( soft_estop_data.begin() + 1,
-                     soft_estop_data.end() ); // Skip the first byte (property ID)
-        age_ms = soft_estop_data_age;
-      }
+      data = { static_cast<uint8_t>( received_frame.soft_estop_active ? 0xff : 0 ),
+               received_frame.soft_estop_sequence };
+    } else if ( id == COMM_PROPERTY_ID_BATTERY && received_frame.battery_valid ) {
+      data = { received_frame.battery_level };
+    } else {
+      return;
+    }
+    age_ms = millis() - received_frame_time;
+  }
+
+  //! Called by the loop, takes over the frames received by the task.
+  void processReceivedFrames()
+  {
+    ReceivedFrame frame;
+    while ( received_frames.pop( frame ) ) {
+      received_frame = frame.frame;
+      received_frame_time = frame.receive_time;
+      received_airtime_us = frame.airtime_us;
+      has_received_frame = true;
     }
+    if ( const uint32_t dropped = received_frames.takeDropped() )
+      ESTOP_LOG_WARNING( LORA, LORA_MAILBOX_FULL, dropped );
   }
 
+  struct ReceivedFrame {
+    LoraFrame frame;
+    //! millis() at the interrupt, i.e., when the packet was received completely.
+    uint32_t receive_time = 0;
+    uint32_t airtime_us = 0;
+  };
+
+  // Only accessed by the task once it was started
   uint8_t buffer[256];
   Radio radio = new Module( RADIO_NSS, RADIO_IRQ, RADIO_RST, RADIO_GPIO );
-  int radio_status = RADIOLIB_ERR_UNKNOWN;
-  std::vector<uint8_t> estop_data;
-  std::vector<uint8_t> soft_estop_data;
-  elapsedMillis last_packet_received_time;
-  elapsedMillis last_send_time;
-  elapsedMillis estop_data_age = 0;
-  elapsedMillis soft_estop_data_age = 0;
+  uint8_t config = LORA_RENDEZVOUS_CONFIG;
+  //! millis() when the configuration was switched.
+  uint32_t config_time = 0;
+  LoraDutyCycle duty_cycle;
+  //! Airtime of a LoraFrame with the configured settings.
+  uint32_t time_on_air_us = 0;
+  //! millis() when the last transmission was started.
+  uint32_t send_time = 0;
+  //! Urgent packets left to send after an E-Stop change.
+  uint8_t urgent_packets = 0;
+  bool last_estop_active = true;
+  bool last_soft_estop_active = true;
+  elapsedMillis duty_cycle_log_time;
+  // Server: the announced switch
+  uint8_t next_config = LORA_RENDEZVOUS_CONFIG;
+  uint8_t switch_packets = 0;
+  bool switch_pending = false;
+  // Client: the link quality
+  LoraLinkAdaptation adaptation;
+
+  // Shared between the task and the loop
+  TaskHandle_t task = nullptr;
+  esp_timer_handle_t transmit_timer = nullptr;
+  std::atomic<int> radio_status{ RADIOLIB_ERR_UNKNOWN };
+  std::atomic<float> rssi{ 0 };
+  // Client: published for the feedback to the server
+  std::atomic<uint8_t> current_config{ LORA_RENDEZVOUS_CONFIG };
+  std::atomic<uint8_t> requested_config{ LORA_RENDEZVOUS_CONFIG };
+  SPSCQueue<ReceivedFrame, 4> received_frames;
+  //! Guards the state to send and the feedback of the receiver.
+  portMUX_TYPE state_mux = portMUX_INITIALIZER_UNLOCKED;
+  // Server: the state that is sent, packets are only sent once the E-Stop state is known
+  LoraFrame send_frame;
+  bool has_estop = false;
+  // Server: the configuration requested by the receiver
+  PropertyValue link_feedback;
+  //! millis() when the feedback was received.
+  uint32_t link_feedback_time = 0;
+  bool has_link_feedback = false;
 
+  // Set by the interrupt
   volatile bool operation_done = false;
+  volatile uint32_t interrupt_time = 0;
+
+  // Client: the last valid frame, only accessed by the loop
+  LoraFrame received_frame;
+  bool has_received_frame = false;
+  //! millis() when the last valid frame was received.
+  uint32_t received_frame_time = 0;
+  uint32_t received_airtime_us = 0;
+
   bool is_server = false;
 };
 
 LoraInterface::Impl *LoraInterface::impl_ = nullptr;
 
-IRAM_ATTR void setDoneFlag( void ) { LoraInterface::impl_->operation_done = true; }
+IRAM_ATTR void onRadioInterrupt( void )
+{
+  LoraInterface::Impl *impl = LoraInterface::impl_;
+  if ( impl == nullptr )
+    return;
+  // millis() is placed in IRAM and reads esp_timer, hence, it is safe to call here and the
+  // timestamp is comparable with the times taken by the loop.
+  impl->interrupt_time = millis();
+  impl->operation_done = true;
+  if ( impl->task == nullptr )
+    return;
+  BaseType_t higher_priority_task_woken = pdFALSE;
+  vTaskNotifyGiveFromISR( impl->task, &higher_priority_task_woken );
+  portYIELD_FROM_ISR( higher_priority_task_woken );
+}
+
+void LoraInterface::Impl::onTransmitTimer( void *arg )
+{
+  xTaskNotifyGive( static_cast<LoraInterface::Impl *>( arg )->task );
+}
+
+void LoraInterface::Impl::runTask( void *arg )
+{
+  auto *impl = static_cast<LoraInterface::Impl *>( arg );
+  for ( ;; ) {
+    // Notified by the interrupt, the transmit timer or a changed state to send
+    ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( LORA_TASK_POLL_MS ) );
+    if ( impl->is_server ) {
+      impl->runServer();
+    } else {
+      impl->runClient();
+    }
+  }
+}
 
 LoraInterface::Impl::Impl( bool is_server ) : is_server( is_server )
 {
-  // These settings result in approx 9 packages per second
-  radio_status = radio.begin( 868, 125, 9, 7, RADIOLIB_SX126X_SYNC_WORD_PRIVATE, 20 );
+  // Sub-band g3 allows 20 dBm and a duty cycle of 10 %, see lora_duty_cycle.h. Both ends start with
+  // the rendezvous configuration, the spreading factor and bandwidth are adapted to the link.
+  const LoraConfig &lora_config = LORA_CONFIGS[LORA_RENDEZVOUS_CONFIG];
+  radio_status = radio.begin( 869.525, lora_config.bandwidth_khz, lora_config.spreading_factor, 7,
+                              RADIOLIB_SX126X_SYNC_WORD_PRIVATE, 20 );
   if ( radio_status != RADIOLIB_ERR_NONE ) {
-    Serial.printf( "Radio initialization error: %d\n", radio_status );
+    ESTOP_LOG_ERROR( LORA, LORA_INIT_ERROR, radio_status.load() );
     return;
   }
-  radio.setDio1Action( setDoneFlag );
+  time_on_air_us = radio.getTimeOnAir( LORA_FRAME_SIZE );
+  config_time = millis();
+  received_frame_time = config_time;
+  adaptation.setConfig( config, config_time );
+  // The server is free to transmit, the client waits for the first packet
+  operation_done = is_server;
+}
+
+void LoraInterface::Impl::start()
+{
+  if ( radio_status != RADIOLIB_ERR_NONE )
+    return;
+  // The interval to the next packet depends on the airtime and the spent budget, so the timer is
+  // armed for every packet instead of running periodically.
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = &Impl::onTransmitTimer;
+  timer_args.arg = this;
+  timer_args.name = "lora_transmit";
+  esp_timer_create( &timer_args, &transmit_timer );
+  // Until the task exists, the interrupt only sets operation_done for the task to pick up
+  radio.setDio1Action( onRadioInterrupt );
   if ( !is_server ) {
     radio_status = radio.startReceive();
   }
+  xTaskCreatePinnedToCore( &Impl::runTask, "LoRa", 4096, this, LORA_TASK_PRIORITY, &task,
+                           ARDUINO_RUNNING_CORE );
 }
 
 LoraInterface::LoraInterface( bool is_server )
@@ -109,24 +304,30 @@ LoraInterface::LoraInterface( bool is_server )
   if ( impl_ != nullptr )
     return;
   impl_ = new Impl( is_server );
+  impl_->start();
 }
 
 unsigned long LoraInterface::getLastReceivedMessageAge() const
 {
-  return impl_->last_packet_received_time;
+  return millis() - impl_->received_frame_time;
 }
 
-void LoraInterface::setProperty( uint8_t id, const std::vector<uint8_t> &data )
+void LoraInterface::setProperty( uint8_t id, const PropertyValue &data )
 {
   impl_->setProperty( id, data );
 }
 
-void LoraInterface::readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const
+void LoraInterface::readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const
 {
   impl_->readProperty( id, data, age_ms );
 }
 
-void LoraInterface::update() { impl_->update(); }
+void LoraInterface::update()
+{
+  // The radio is served by the task, only the received frames are taken over here
+  if ( !impl_->is_server )
+    impl_->processReceivedFrames();
+}
 
 CommState LoraInterface::getCommState() const
 {
@@ -134,50 +335,157 @@ CommState LoraInterface::getCommState() const
     return CommState::ERROR;
   }
   if (impl_->is_server) return CommState::CONNECTED; // Server always connected
-  return impl_->last_packet_received_time < 500 ? CommState::CONNECTED : CommState::DISCONNECTED;
+  return getLastReceivedMessageAge() < LORA_CONNECTION_TIMEOUT_MS ? CommState::CONNECTED
+                                                                  : CommState::DISCONNECTED;
+}
+
+float LoraInterface::getRSSI() const { return impl_->rssi; }
+
+unsigned long LoraInterface::getTransmitDurationMs() const
+{
+  return impl_->received_airtime_us / 1000 + LORA_TRANSMIT_MARGIN_MS;
+}
+
+PropertyValue LoraInterface::getLinkFeedback() const
+{
+  return { impl_->current_config, impl_->requested_config };
 }
 
-float LoraInterface::getRSSI() const { return impl_->radio.getRSSI(); }
+void LoraInterface::setLinkFeedback( const PropertyValue &data, unsigned long age_ms )
+{
+  if ( age_ms == ULONG_MAX )
+    return;
+  const uint32_t feedback_time = millis() - age_ms;
+  portENTER_CRITICAL( &impl_->state_mux );
+  impl_->link_feedback = data;
+  impl_->link_feedback_time = feedback_time;
+  impl_->has_link_feedback = true;
+  portEXIT_CRITICAL( &impl_->state_mux );
+}
 
-void LoraInterface::Impl::updateServer()
+void LoraInterface::Impl::runServer()
 {
   if ( !operation_done ) {
-    if ( last_send_time < 200 )
+    if ( millis() - send_time < time_on_air_us / 1000 + LORA_TRANSMIT_TIMEOUT_MARGIN_MS )
       return;
-    static elapsedMillis last_error_print = 5000;
-    if ( last_error_print > 2000 ) {
-      last_error_print = 0;
-      Serial.printf( "Sent was never set to true." );
-    }
+    ESTOP_LOG_WARNING( LORA, LORA_TRANSMIT_TIMEOUT );
     radio.finishTransmit();
+    operation_done = true;
   }
-  sendData( estop_data ); // Resend the last packet
+  updateServerConfig();
+  portENTER_CRITICAL( &state_mux );
+  LoraFrame frame = send_frame;
+  const bool ready = has_estop;
+  portEXIT_CRITICAL( &state_mux );
+  if ( !ready )
+    return;
+  // Changes are sent urgently, the periodic packets keep the receiver up to date otherwise
+  if ( frame.estop_active != last_estop_active ||
+       frame.soft_estop_active != last_soft_estop_active ) {
+    last_estop_active = frame.estop_active;
+    last_soft_estop_active = frame.soft_estop_active;
+    urgent_packets = LORA_URGENT_PACKETS;
+  }
+  // Switches are announced urgently as well, the receiver follows with the first flagged packet
+  const bool urgent = urgent_packets > 0 || switch_packets > 0;
+  const uint32_t now = millis();
+  const uint32_t delay_ms = duty_cycle.getDelay( time_on_air_us, urgent, now );
+  if ( delay_ms > 0 ) {
+    if ( urgent && duty_cycle_log_time >= 1000 ) {
+      ESTOP_LOG_WARNING( LORA, LORA_DUTY_CYCLE_EXHAUSTED, duty_cycle.getUsed( now ) / 1000 );
+      duty_cycle_log_time = 0;
+    }
+    notifyAfter( delay_ms );
+    return;
+  }
+  if ( urgent_packets > 0 )
+    --urgent_packets;
+  // Send the latest state, startTransmit copies the packet to the radio
+  if ( switch_packets > 0 ) {
+    frame.switch_config = true;
+    frame.next_config = next_config;
+    --switch_packets;
+  }
+  uint8_t packet[LORA_FRAME_SIZE];
+  encodeLoraFrame( frame, packet );
+  sendData( packet, sizeof( packet ) );
+  // The interrupt notifies the task once the packet was sent, the timer only if it never fires
+  notifyAfter( time_on_air_us / 1000 + LORA_TRANSMIT_TIMEOUT_MARGIN_MS );
 }
 
-void LoraInterface::Impl::updateClient()
+void LoraInterface::Impl::updateServerConfig()
 {
+  const uint32_t now = millis();
+  if ( switch_pending ) {
+    // The radio is free, the last announcing packet was sent
+    if ( switch_packets == 0 ) {
+      switch_pending = false;
+      applyConfig( next_config );
+    }
+    return;
+  }
+  portENTER_CRITICAL( &state_mux );
+  const PropertyValue feedback = link_feedback;
+  const uint32_t feedback_time = link_feedback_time;
+  const bool has_feedback = has_link_feedback && feedback.size() >= 2 &&
+                            now - feedback_time < LORA_RENDEZVOUS_TIMEOUT_MS;
+  portEXIT_CRITICAL( &state_mux );
+  if ( !has_feedback ) {
+    // The receiver is out of reach or the feedback links are down, meet at the rendezvous
+    if ( config != LORA_RENDEZVOUS_CONFIG && now - config_time >= LORA_RENDEZVOUS_TIMEOUT_MS ) {
+      ESTOP_LOG_WARNING( LORA, LORA_RENDEZVOUS );
+      announceConfig( LORA_RENDEZVOUS_CONFIG );
+    }
+    return;
+  }
+  // Feedback sent before the receiver followed the last switch may still arrive
+  if ( now - config_time < LORA_FEEDBACK_SETTLE_MS ||
+       static_cast<int32_t>( feedback_time - config_time ) < 0 )
+    return;
+  const uint8_t receiver_config = feedback[0];
+  const uint8_t requested_config = feedback[1];
+  if ( receiver_config >= LORA_CONFIG_COUNT || requested_config >= LORA_CONFIG_COUNT )
+    return;
+  if ( receiver_config != config ) {
+    // The receiver fell back to the rendezvous or missed the announcement, follow it
+    applyConfig( receiver_config );
+  } else if ( requested_config != config ) {
+    announceConfig( requested_config );
+  }
+}
+
+void LoraInterface::Impl::runClient()
+{
+  if ( adaptation.update( duty_cycle.getInterval( time_on_air_us ), millis() ) ) {
+    ESTOP_LOG_WARNING( LORA, LORA_RENDEZVOUS );
+    applyConfig( LORA_RENDEZVOUS_CONFIG );
+  }
+  requested_config = adaptation.getRequestedConfig();
   if ( !operation_done ) {
     return;
   }
   operation_done = false;
-  int len = radio.getPacketLength();
-  if ( len <= 0 )
+  ReceivedFrame frame;
+  frame.receive_time = interrupt_time;
+  frame.airtime_us = time_on_air_us;
+  const size_t len = std::min<size_t>( radio.getPacketLength(), sizeof( buffer ) );
+  if ( len == 0 )
     return;
   int result = radio.readData( buffer, len );
   if ( result != RADIOLIB_ERR_NONE ) {
-    Serial.printf( "Radio read error: %d\n", result );
+    ESTOP_LOG_WARNING( LORA, LORA_READ_ERROR, result );
     return;
   }
-  int id = buffer[0];
-  if ( id == COMM_PROPERTY_ID_ESTOP ) {
-    estop_data.assign( buffer, buffer + len );
-    estop_data_age = 0; // Reset age on valid packet
-  } else if ( id == COMM_PROPERTY_ID_SOFT_ESTOP ) {
-    soft_estop_data.assign( buffer, buffer + len );
-    soft_estop_data_age = 0; // Reset age on valid packet
-  } else {
-    Serial.printf( "Received unknown property ID: %d\n", id );
+  if ( !decodeLoraFrame( buffer, len, frame.frame ) ) {
+    ESTOP_LOG_WARNING( LORA, LORA_INVALID_FRAME, len );
     return;
   }
-  last_packet_received_time = 0;
+  rssi = radio.getRSSI();
+  received_frames.push( frame );
+  if ( !frame.frame.switch_config ) {
+    adaptation.addPacket( radio.getSNR(), frame.receive_time );
+  } else if ( frame.frame.next_config < LORA_CONFIG_COUNT && frame.frame.next_config != config ) {
+    applyConfig( frame.frame.next_config );
+    requested_config = adaptation.getRequestedConfig();
+  }
 }
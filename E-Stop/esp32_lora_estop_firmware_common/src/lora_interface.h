@@ -1,29 +1,44 @@
 #pragma once
 
-#include "comm_interface.h"
+#include "comm_transport.h"
 #include <memory>
-#include <vector>
 
-class LoraInterface
+class LoraInterface : public TransportInterface
 {
 public:
   LoraInterface( bool is_server );
 
-  void update();
+  CommTransport getTransportType() const override { return CommTransport::LORA; }
 
-  CommState getCommState() const;
+  void update() override;
 
-  float getRSSI() const;
+  CommState getCommState() const override;
+
+  float getRSSI() const override;
+
+  //! The airtime of the last received packet, its age is measured from the end of the packet.
+  unsigned long getTransmitDurationMs() const override;
+
+  //! The server sends changes urgently and the latest state periodically within the duty cycle.
+  bool sendsEveryUpdate() const override { return false; }
 
   unsigned long getLastReceivedMessageAge() const;
 
   bool hasProperty( uint8_t id ) const
   {
-    return id == COMM_PROPERTY_ID_ESTOP || id == COMM_PROPERTY_ID_SOFT_ESTOP;
+    return id == COMM_PROPERTY_ID_ESTOP || id == COMM_PROPERTY_ID_SOFT_ESTOP ||
+           id == COMM_PROPERTY_ID_BATTERY;
   }
 
-  void setProperty( uint8_t id, const std::vector<uint8_t> &data );
-  void readProperty( uint8_t id, std::vector<uint8_t> &data, unsigned long &age_ms ) const;
+  void setProperty( uint8_t id, const PropertyValue &data ) override;
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override;
+
+  //! Client: the current and the requested configuration, sent to the server as
+  //! COMM_PROPERTY_ID_LORA_LINK.
+  PropertyValue getLinkFeedback() const;
+
+  //! Server: the newest COMM_PROPERTY_ID_LORA_LINK received from the client.
+  void setLinkFeedback( const PropertyValue &data, unsigned long age_ms );
 
   class Impl;
   static Impl *impl_;
@@ -41,6 +41,8 @@ public:
 
   void write( const uint8_t *data, size_t length ) override { serial_.write( data, length ); }
 
+  int availableForWrite() const override { return serial_.availableForWrite(); }
+
 private:
   SerialType &serial_;
 };
@@ -9,6 +9,8 @@
 #include "crosstalk.hpp"
 #include "crosstalk_hardware_serial_wrapper.hpp"
 
+#include <atomic>
+
 #define ESTOP_OUT_PIN D3
 
 CommInterface remote_comm;
@@ -17,17 +19,35 @@ DeadmanCommInterface deadman_comm;
 elapsedMillis last_estop_send = 0;
 elapsedMillis last_comm_status_send = 0;
 elapsedMillis last_print = 0;
-crosstalk::CrossTalker<512, 64>
+// Objects are only sent through host_tx_queue, which serializes them into its slots, hence, the
+// CrossTalker needs no serialization buffer.
+crosstalk::CrossTalker<512, 0>
     host_comm( std::make_unique<crosstalk::HardwareSerialWrapper<HWCDC>>( Serial ) );
+static_assert( HostToReceiverObjects::max_frame_size() <= 512,
+               "Receive buffer is too small for the host to receiver objects." );
+// Frames are queued and flushed by priority to prevent status frames from delaying E-Stop frames.
+// Status and log frames only fill the TX buffer up to the size of one frame, hence, an E-Stop frame
+// waits behind at most that many bytes.
+constexpr int HOST_TX_BUFFER_SIZE = 256;
+crosstalk::PriorityTxQueue<ReceiverToHostObjects::max_frame_size(), 8>
+    host_tx_queue( HOST_TX_BUFFER_SIZE - ReceiverToHostObjects::max_frame_size() );
+// Log records that did not fit into the queue, e.g., because the host stopped reading
+std::atomic<uint32_t> dropped_log_records{ 0 };
 
 void setup()
 {
+  Serial.setTxBufferSize( HOST_TX_BUFFER_SIZE );
   Serial.begin( 115200 );
-  Serial.println( "Starting HECTOR E-Stop Remote..." );
+  // Log records are sent as objects to the host instead of text interleaved with the frames
+  setLogSink( []( const LogRecord &record ) {
+    if ( host_tx_queue.push( record ) != crosstalk::WriteResult::Success )
+      dropped_log_records.fetch_add( 1, std::memory_order_relaxed );
+  } );
+  ESTOP_LOG_INFO( MAIN, STARTING );
   remote_comm.initialize( CommMode::SERVER, SENDER_PEER_INFO );
-  Serial.println( "CommInterface initialized" );
+  ESTOP_LOG_INFO( MAIN, COMM_INITIALIZED );
   deadman_comm.initialize( remote_comm.getBLEInterface(), DEADMAN_PEER_INFO );
-  Serial.println( "DeadmanCommInterface initialized" );
+  ESTOP_LOG_INFO( MAIN, DEADMAN_INITIALIZED );
   pinMode( LED_BUILTIN, OUTPUT );
   digitalWrite( LED_BUILTIN, LOW );
 
@@ -39,6 +59,10 @@ void setup()
 bool enabled = true;
 bool last_estop_active = true;
 bool last_soft_estop_active = true;
+uint32_t last_trace_receive_time_ms = 0;
+// Latest-value slot of the E-Stop state. A state that did not fit into the queue stays pending and
+// is replaced by the newest state until it is queued, instead of being dropped.
+bool estop_state_pending = false;
 
 void loop()
 {
@@ -52,42 +76,53 @@ void loop()
   const bool current_soft_estop_active = remote_comm.getSoftEStopState();
   digitalWrite( ESTOP_OUT_PIN, enabled && current_estop_active ? LOW : HIGH );
 
+  // Newly received states are forwarded immediately to measure the latency of every received packet
+  const EStopTrace trace = remote_comm.getEStopTrace();
   if ( last_estop_send > 100 || current_estop_active != last_estop_active ||
-       current_soft_estop_active != last_soft_estop_active ) {
+       current_soft_estop_active != last_soft_estop_active ||
+       trace.receive_time_ms != last_trace_receive_time_ms ) {
     last_estop_send = 0;
     last_estop_active = current_estop_active;
     last_soft_estop_active = current_soft_estop_active;
-    host_comm.sendObject( EStopState{
+    last_trace_receive_time_ms = trace.receive_time_ms;
+    estop_state_pending = true;
+    digitalWrite( LED_BUILTIN, last_estop_active ? LOW : HIGH );
+  }
+  if ( estop_state_pending ) {
+    estop_state_pending = host_tx_queue.push( EStopState{
         .enabled = enabled,
         .hard_estop_active = remote_comm.getEStopState(),
         .soft_estop_active = remote_comm.getSoftEStopState(),
         .deadman_active  = deadman_active,
-        .deadman_triggered = deadman_triggered
-    } );
-    digitalWrite( LED_BUILTIN, last_estop_active ? LOW : HIGH );
+        .deadman_triggered = deadman_triggered,
+        .trace = trace,
+        .send_time_ms = millis()
+    } ) != crosstalk::WriteResult::Success;
   }
 
-  if ( last_comm_status_send > 500 ) {
+  // The status is retried in the next loop if the queue is full
+  if ( last_comm_status_send > 500 &&
+       host_tx_queue.push( status ) == crosstalk::WriteResult::Success ) {
     last_comm_status_send = 0;
-    host_comm.sendObject( status );
+    // At most every 500 ms to stay within the rate limit of the log
+    if ( const uint32_t dropped = dropped_log_records.exchange( 0, std::memory_order_relaxed ) )
+      ESTOP_LOG_WARNING( HOST, HOST_TX_QUEUE_FULL, static_cast<int32_t>( dropped ) );
   }
+  host_tx_queue.flush( host_comm );
 
   host_comm.processSerialData();
   if ( host_comm.available() )
     host_comm.skip();
-  if ( host_comm.hasObject() ) {
-    int16_t object_id = host_comm.getObjectId();
-    switch ( object_id ) {
-    case crosstalk::object_id<SetEnabledCommand>():
-      SetEnabledCommand cmd;
-      if ( host_comm.readObject( cmd ) == crosstalk::ReadResult::Success ) {
+  const crosstalk::ReadResult result = HostToReceiverObjects::dispatch(
+      host_comm,
+      []( const SetEnabledCommand &cmd ) {
         enabled = cmd.enabled;
-        Serial.printf( "Set E-Stop enabled to: %s\n", cmd.enabled ? "true" : "false" );
-      } else {
-        Serial.println( "Failed to read SetEnabledCommand object" );
-      }
-      break;
-    }
+        ESTOP_LOG_INFO( HOST, SET_ENABLED, cmd.enabled );
+      },
+      []( int16_t id ) { ESTOP_LOG_WARNING( HOST, UNKNOWN_OBJECT_ID, id ); } );
+  if ( result == crosstalk::ReadResult::CrcError ||
+       result == crosstalk::ReadResult::ObjectSizeMismatch ) {
+    ESTOP_LOG_WARNING( HOST, READ_OBJECT_FAILED, static_cast<int32_t>( result ) );
   }
 
   // if ( last_print > 1000 ) {
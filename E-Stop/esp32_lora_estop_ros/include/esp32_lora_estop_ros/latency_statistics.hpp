@@ -0,0 +1,115 @@
+#ifndef ESP32_LORA_ESTOP_ROS_LATENCY_STATISTICS_HPP
+#define ESP32_LORA_ESTOP_ROS_LATENCY_STATISTICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace esp32_lora_estop_ros
+{
+
+/*!
+ * Histogram of latencies with logarithmic buckets from 1 us to about 16 s.
+ * Each power of two is split into 16 buckets, hence, quantiles have a relative error below 6.25%.
+ * Adding a value does not allocate.
+ */
+class LatencyHistogram
+{
+public:
+  void add( double latency_ms )
+  {
+    latency_ms = std::max( latency_ms, 0.0 );
+    const auto us = static_cast<uint64_t>( latency_ms * 1000 );
+    ++buckets_[std::min( bucketIndex( us ), buckets_.size() - 1 )];
+    ++count_;
+    max_ms_ = std::max( max_ms_, latency_ms );
+  }
+
+  size_t count() const { return count_; }
+
+  double max() const { return max_ms_; }
+
+  //! Returns the upper bound of the bucket containing the quantile q in [0, 1] in ms.
+  double quantile( double q ) const
+  {
+    if ( count_ == 0 )
+      return 0;
+    const auto rank = static_cast<size_t>( std::ceil( q * count_ ) );
+    size_t seen = 0;
+    for ( size_t i = 0; i + 1 < buckets_.size(); ++i ) {
+      seen += buckets_[i];
+      if ( seen >= std::max<size_t>( rank, 1 ) )
+        return std::min( bucketUpperBound( i ) / 1000.0, max_ms_ );
+    }
+    return max_ms_; // The last bucket has no upper bound
+  }
+
+  void reset() { *this = LatencyHistogram(); }
+
+private:
+  static constexpr int sub_bucket_bits = 4;
+  static constexpr uint64_t sub_bucket_count = 1 << sub_bucket_bits;
+
+  static size_t bucketIndex( uint64_t us )
+  {
+    if ( us < 2 * sub_bucket_count )
+      return us;
+    int msb = 63;
+    while ( ( us >> msb ) == 0 ) --msb;
+    const int shift = msb - sub_bucket_bits;
+    return shift * sub_bucket_count + ( us >> shift );
+  }
+
+  static uint64_t bucketUpperBound( size_t index )
+  {
+    if ( index < 2 * sub_bucket_count )
+      return index + 1;
+    const size_t shift = index / sub_bucket_count - 1;
+    return ( ( index % sub_bucket_count + sub_bucket_count + 1 ) << shift );
+  }
+
+  // 2^24 us ~ 16.8 s, larger values are counted in the last bucket
+  std::array<uint32_t, ( 24 - sub_bucket_bits + 1 ) * sub_bucket_count> buckets_ = {};
+  size_t count_ = 0;
+  double max_ms_ = 0;
+};
+
+/*!
+ * Estimates the offset between two clocks that are not synchronized, e.g., of the sender and the
+ * receiver, as the smallest difference between a receive and a send time.
+ * Latencies computed with it are relative to the fastest delivery observed in the last one to two
+ * windows. The window is restarted periodically to follow the drift of the clocks.
+ */
+class ClockOffsetEstimator
+{
+public:
+  explicit ClockOffsetEstimator(
+      std::chrono::steady_clock::duration window = std::chrono::seconds( 10 ) )
+      : window_( window )
+  {
+  }
+
+  //! Adds the difference of a receive and a send time and returns the latency above the minimum.
+  double update( double difference_ms, std::chrono::steady_clock::time_point now )
+  {
+    if ( now - window_start_ > window_ ) {
+      previous_min_ms_ = current_min_ms_;
+      current_min_ms_ = std::numeric_limits<double>::infinity();
+      window_start_ = now;
+    }
+    current_min_ms_ = std::min( current_min_ms_, difference_ms );
+    return difference_ms - std::min( current_min_ms_, previous_min_ms_ );
+  }
+
+private:
+  std::chrono::steady_clock::duration window_;
+  std::chrono::steady_clock::time_point window_start_;
+  double current_min_ms_ = std::numeric_limits<double>::infinity();
+  double previous_min_ms_ = std::numeric_limits<double>::infinity();
+};
+} // namespace esp32_lora_estop_ros
+
+#endif // ESP32_LORA_ESTOP_ROS_LATENCY_STATISTICS_HPP
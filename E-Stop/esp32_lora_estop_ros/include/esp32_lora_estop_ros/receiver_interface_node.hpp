@@ -1,25 +1,38 @@
 #ifndef ESP32_LORA_ESTOP_ROS_INTERFACE_RECEIVER_INTERFACE_NODE_HPP
 #define ESP32_LORA_ESTOP_ROS_INTERFACE_RECEIVER_INTERFACE_NODE_HPP
 
+#include <array>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <esp32_lora_estop_interface/msg/comm_status.hpp>
 #include <esp32_lora_estop_interface/srv/set_enabled.hpp>
 #include <hector_ros2_utils/lifecycle_node.hpp>
-#include <libserial/SerialPort.h>
 #include <lifecycle_msgs/msg/state.hpp>
 #include <lifecycle_msgs/msg/transition.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp_lifecycle/lifecycle_publisher.hpp>
 #include <std_msgs/msg/bool.hpp>
 
+#include "esp32_lora_estop_ros/latency_statistics.hpp"
+
+struct EStopState;
+
 namespace crosstalk
 {
-template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE>
+template<int BUFFER_SIZE, int SERIALIZATION_BUFFER_SIZE, template<int> class RingStorage>
 class CrossTalker;
-}
+
+template<int SIZE>
+class MirroredRingStorage;
+
+template<size_t SLOT_SIZE, size_t SLOT_COUNT>
+class TxQueue;
+} // namespace crosstalk
 
 namespace esp32_lora_estop_ros
 {
@@ -29,6 +42,8 @@ class ReceiverInterfaceNode : public hector::LifecycleNode
 public:
   explicit ReceiverInterfaceNode( const rclcpp::NodeOptions &options );
 
+  ~ReceiverInterfaceNode() override;
+
 protected:
   /**
    * @brief Processes 'configuring' transitions to 'inactive' state
@@ -81,24 +96,116 @@ private:
 
   void initSerialPort();
 
-  void loopCallback();
+  /*!
+   * Processes the objects available on the serial port.
+   * Only called from the reader thread which owns the cross talker while it is running.
+   * @return False if objects are left because the maximum number of objects per cycle was reached.
+   */
+  bool processObjects();
+
+  //! Publishes the E-Stop states if they changed. Called for every state read from the port.
+  void handleEStopState( const EStopState &estop_state,
+                         std::chrono::steady_clock::time_point receive_time );
+
+  //! Reads the text before the next frame, e.g., boot messages of the receiver, and logs each line.
+  void readText();
+
+  //! Writes the objects queued by other threads to the serial port.
+  void sendQueuedObjects();
+
+  //! Starts the thread that waits for serial data and processes it as soon as it arrives.
+  void startReaderThread();
+
+  void stopReaderThread();
+
+  //! Applies the real-time priority and CPU affinity parameters to the calling thread.
+  void configureReaderThread();
+
+  void readerThreadLoop();
+
+  //! Logs the queue statistics and resets them if the statistics period has passed.
+  void reportStatistics( std::chrono::steady_clock::time_point now );
+
+  //! Records the latency of each hop of the E-Stop state from the sender until it was published.
+  void recordLatency( const EStopState &state, std::chrono::steady_clock::time_point receive_time,
+                      std::chrono::steady_clock::time_point publish_time );
+
+  //! Publishes the latency histograms as diagnostics and resets them if the period has passed.
+  void publishLatencyDiagnostics( std::chrono::steady_clock::time_point now );
 
   void onSetEnabled( const esp32_lora_estop_interface::srv::SetEnabled::Request::SharedPtr request,
                      esp32_lora_estop_interface::srv::SetEnabled::Response::SharedPtr response );
 
 private:
+  //! Statistics of the objects processed per loop cycle since the last report.
+  struct QueueStatistics {
+    size_t cycles = 0;
+    size_t frames = 0;
+    size_t budget_exhausted = 0;
+    int max_frames_per_cycle = 0;
+    //! Upper bounds for the time between arrival and processing of an object.
+    double sum_delay_ms = 0;
+    double max_delay_ms = 0;
+    double max_estop_delay_ms = 0;
+  };
+
+  //! Latencies of the traced E-Stop states since the last diagnostics message.
+  struct LatencyStatistics {
+    //! Sender to receiver. Relative to the fastest delivery since the clocks are not synchronized.
+    LatencyHistogram radio;
+    //! Receive to send on the receiver including the time in the TX queue.
+    LatencyHistogram receiver;
+    //! Receiver to host. Relative to the fastest delivery since the clocks are not synchronized.
+    LatencyHistogram serial;
+    //! Reading the object to publishing on the host.
+    LatencyHistogram host;
+    //! Sum of all hops for packets with a known sender time.
+    LatencyHistogram total;
+    //! Sum of all hops for packets that changed the E-Stop state.
+    LatencyHistogram state_change;
+  };
+
   template<typename Msg>
   using Publisher = rclcpp_lifecycle::LifecyclePublisher<Msg>;
   Publisher<std_msgs::msg::Bool>::SharedPtr estop_publisher_;
   Publisher<std_msgs::msg::Bool>::SharedPtr soft_estop_publisher_;
   Publisher<esp32_lora_estop_interface::msg::CommStatus>::SharedPtr remote_comm_status_publisher_;
   Publisher<esp32_lora_estop_interface::msg::CommStatus>::SharedPtr deadman_comm_status_publisher_;
+  Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_publisher_;
   rclcpp::Service<esp32_lora_estop_interface::srv::SetEnabled>::SharedPtr set_enabled_service_;
-  rclcpp::TimerBase::SharedPtr loop_timer_;
+  std::thread reader_thread_;
+  int stop_event_fd_ = -1;
+  int reader_realtime_priority_ = 0;
+  int reader_cpu_affinity_ = -1;
+  //! Objects sent from other threads, e.g., the service. Written to the port by the reader thread.
+  std::unique_ptr<crosstalk::TxQueue<128, 16>> tx_queue_;
+  //! Wakes the reader thread when objects were queued.
+  int tx_event_fd_ = -1;
   std::string port_ = "/dev/tty_estop_receiver";
-  std::unique_ptr<LibSerial::SerialPort> serial_port_;
-  std::unique_ptr<crosstalk::CrossTalker<2048, 128>> cross_talker_;
+  int baud_rate_ = 115200;
+  //! File descriptor of the serial port. Owned by the serial abstraction of cross_talker_.
+  int serial_fd_ = -1;
+  std::unique_ptr<crosstalk::CrossTalker<4096, 128, crosstalk::MirroredRingStorage>> cross_talker_;
+  //! Incomplete line of text from the receiver. Logged once it is complete or the buffer is full.
+  std::array<char, 256> text_line_;
+  size_t text_line_size_ = 0;
   int error_count_ = 0;
+  int max_objects_per_cycle_ = 64;
+  double statistics_period_ = 0;
+  QueueStatistics statistics_;
+  std::chrono::steady_clock::time_point statistics_start_time_;
+  //! Time the serial port was last polled with all complete objects processed afterwards.
+  std::chrono::steady_clock::time_point last_drained_time_;
+  double latency_diagnostics_period_ = 1.0;
+  LatencyStatistics latency_;
+  std::chrono::steady_clock::time_point latency_start_time_;
+  ClockOffsetEstimator radio_clock_offset_;
+  ClockOffsetEstimator serial_clock_offset_;
+  //! Identifies the trace of the last E-Stop state. Repeated traces are not recorded again.
+  uint32_t last_trace_receive_time_ms_ = 0;
+  uint8_t last_trace_sequence_ = 0;
+  bool last_trace_active_ = false;
+  bool has_last_trace_ = false;
   bool estop_state_ = true;
   bool soft_estop_state_ = true;
   bool first_publish_ = true;
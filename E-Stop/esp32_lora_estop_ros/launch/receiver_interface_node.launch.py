@@ -0,0 +1,52 @@
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import Node
+from launch_ros.parameter_descriptions import ParameterValue
+
+
+def generate_launch_description():
+    arguments = [
+        DeclareLaunchArgument(
+            "serial_port",
+            default_value="/dev/tty_estop_receiver",
+            description="Serial port of the E-Stop receiver",
+        ),
+        DeclareLaunchArgument("baud_rate", default_value="115200"),
+        DeclareLaunchArgument(
+            "realtime_priority",
+            default_value="0",
+            description="SCHED_FIFO priority of the serial reader thread. 0 to disable.",
+        ),
+        DeclareLaunchArgument(
+            "cpu_affinity",
+            default_value="-1",
+            description="CPU core the serial reader thread is pinned to. -1 to disable.",
+        ),
+        DeclareLaunchArgument(
+            "latency_diagnostics_period",
+            default_value="1.0",
+            description="Period in seconds for publishing E-Stop latency histograms. 0 to disable.",
+        ),
+    ]
+    node = Node(
+        package="esp32_lora_estop_ros",
+        executable="receiver_interface_node",
+        output="screen",
+        parameters=[
+            {
+                "serial_port": LaunchConfiguration("serial_port"),
+                "baud_rate": ParameterValue(LaunchConfiguration("baud_rate"), value_type=int),
+                "reader_thread.realtime_priority": ParameterValue(
+                    LaunchConfiguration("realtime_priority"), value_type=int
+                ),
+                "reader_thread.cpu_affinity": ParameterValue(
+                    LaunchConfiguration("cpu_affinity"), value_type=int
+                ),
+                "latency_diagnostics_period": ParameterValue(
+                    LaunchConfiguration("latency_diagnostics_period"), value_type=float
+                ),
+            }
+        ],
+    )
+    return LaunchDescription(arguments + [node])
@@ -0,0 +1,98 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2025 Stefan Fabian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CROSSTALK_MIRRORED_RING_STORAGE_HPP
+#define CROSSTALK_MIRRORED_RING_STORAGE_HPP
+
+#ifndef CROSSTALK_CROSSTALKER_HPP
+  #error "Include crosstalk.hpp before including crosstalk_mirrored_ring_storage.hpp"
+#endif // CROSSTALK_CROSSTALKER_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace crosstalk
+{
+/*!
+ * Ring buffer storage for Linux that maps the same memfd pages twice back to back.
+ * Every range of up to SIZE bytes starting inside the buffer is contiguous in memory, hence, the
+ * CrossTalker does not need to handle objects wrapping around the end of the buffer.
+ *
+ * SIZE has to be a multiple of the page size. Throws std::runtime_error if the mapping fails.
+ */
+template<int SIZE>
+class MirroredRingStorage
+{
+public:
+  static constexpr bool mirrored = true;
+  static_assert( SIZE > 0 && SIZE % 4096 == 0, "SIZE must be a multiple of the page size." );
+
+  MirroredRingStorage()
+  {
+    const long page_size = sysconf( _SC_PAGESIZE );
+    if ( page_size <= 0 || SIZE % page_size != 0 )
+      throw std::runtime_error( "Mirrored ring buffer size must be a multiple of the page size." );
+    int fd = memfd_create( "crosstalk_ring_buffer", MFD_CLOEXEC );
+    if ( fd == -1 )
+      throw std::runtime_error( "Failed to create memfd for mirrored ring buffer." );
+    if ( ftruncate( fd, SIZE ) != 0 ) {
+      close( fd );
+      throw std::runtime_error( "Failed to resize memfd for mirrored ring buffer." );
+    }
+    // Reserve the address range for both mappings, then map the file twice into it
+    void *address = mmap( nullptr, 2 * SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( address == MAP_FAILED ) {
+      close( fd );
+      throw std::runtime_error( "Failed to reserve memory for mirrored ring buffer." );
+    }
+    auto *base = static_cast<uint8_t *>( address );
+    if ( mmap( base, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 ) == MAP_FAILED ||
+         mmap( base + SIZE, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 ) ==
+             MAP_FAILED ) {
+      munmap( base, 2 * SIZE );
+      close( fd );
+      throw std::runtime_error( "Failed to map mirrored ring buffer." );
+    }
+    close( fd ); // The mappings keep the memory alive
+    data_ = base;
+  }
+
+  ~MirroredRingStorage() { munmap( data_, 2 * SIZE ); }
+
+  MirroredRingStorage( const MirroredRingStorage & ) = delete;
+  MirroredRingStorage &operator=( const MirroredRingStorage & ) = delete;
+
+  uint8_t &operator[]( int index ) { return data_[index]; }
+  const uint8_t &operator[]( int index ) const { return data_[index]; }
+
+  uint8_t *data() { return data_; }
+  const uint8_t *data() const { return data_; }
+
+private:
+  uint8_t *data_ = nullptr;
+};
+} // namespace crosstalk
+
+#endif // CROSSTALK_MIRRORED_RING_STORAGE_HPP
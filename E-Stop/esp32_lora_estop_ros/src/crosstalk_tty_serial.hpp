@@ -0,0 +1,194 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2025 Stefan Fabian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef CROSSTALK_TTY_SERIAL_HPP
+#define CROSSTALK_TTY_SERIAL_HPP
+
+#ifndef CROSSTALK_SERIAL_ABSTRACTION_HPP
+  #error "Include crosstalk.hpp or crosstalk/serial_abstraction.hpp before including crosstalk_tty_serial.hpp"
+#endif // CROSSTALK_SERIAL_ABSTRACTION_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <linux/serial.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace crosstalk
+{
+/*!
+ * Serial abstraction operating directly on a non-blocking tty file descriptor.
+ *
+ * The port is configured in raw mode and, if the driver supports it, with ASYNC_LOW_LATENCY.
+ * Reads go directly into the buffer passed by the CrossTalker without querying the number of
+ * available bytes first. Instead, available() reports data until a read returns less than
+ * requested, hence, each processSerialData call costs a single read syscall if data is pending.
+ */
+class TtySerial : public crosstalk::SerialAbstraction
+{
+public:
+  //! Opens and configures the given device. Throws std::runtime_error on failure.
+  explicit TtySerial( const std::string &device, int baud_rate = 115200 )
+  {
+    fd_ = ::open( device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC );
+    if ( fd_ == -1 )
+      throw std::runtime_error( "Failed to open " + device + ": " + std::strerror( errno ) );
+    try {
+      configure( baud_rate );
+    } catch ( ... ) {
+      ::close( fd_ );
+      throw;
+    }
+  }
+
+  ~TtySerial() override
+  {
+    if ( fd_ != -1 )
+      ::close( fd_ );
+  }
+
+  TtySerial( const TtySerial & ) = delete;
+  TtySerial &operator=( const TtySerial & ) = delete;
+
+  //! The file descriptor of the port, e.g., to wait for data using poll.
+  int fd() const { return fd_; }
+
+  //! Whether ASYNC_LOW_LATENCY was enabled. Not supported by all drivers, e.g., USB CDC ACM.
+  bool lowLatency() const { return low_latency_; }
+
+  int available() const override
+  {
+    if ( drained_ ) {
+      // The next call probes the port again
+      drained_ = false;
+      return 0;
+    }
+    return std::numeric_limits<int>::max();
+  }
+
+  int read( uint8_t *data, size_t length ) override
+  {
+    ssize_t result;
+    do {
+      result = ::read( fd_, data, length );
+    } while ( result == -1 && errno == EINTR );
+    if ( result == -1 ) {
+      drained_ = true;
+      if ( errno == EAGAIN || errno == EWOULDBLOCK )
+        return 0;
+      throw std::runtime_error( std::string( "Failed to read from serial port: " ) +
+                                std::strerror( errno ) );
+    }
+    // With VMIN = 0 and VTIME = 0, a read without pending data returns 0 instead of EAGAIN
+    drained_ = static_cast<size_t>( result ) < length;
+    return static_cast<int>( result );
+  }
+
+  void write( const uint8_t *data, size_t length ) override
+  {
+    while ( length > 0 ) {
+      const ssize_t result = ::write( fd_, data, length );
+      if ( result >= 0 ) {
+        data += result;
+        length -= result;
+        continue;
+      }
+      if ( errno == EINTR )
+        continue;
+      if ( errno != EAGAIN && errno != EWOULDBLOCK )
+        throw std::runtime_error( std::string( "Failed to write to serial port: " ) +
+                                  std::strerror( errno ) );
+      // Output buffer is full, wait until the driver accepts more data
+      pollfd pfd = { fd_, POLLOUT, 0 };
+      if ( ::poll( &pfd, 1, 1000 ) <= 0 )
+        throw std::runtime_error( "Timeout while writing to serial port." );
+    }
+  }
+
+private:
+  void configure( int baud_rate )
+  {
+    termios tty{};
+    if ( tcgetattr( fd_, &tty ) != 0 )
+      throw std::runtime_error( std::string( "Failed to get serial port attributes: " ) +
+                                std::strerror( errno ) );
+    cfmakeraw( &tty );
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~( CSTOPB | CRTSCTS );
+    tty.c_iflag &= ~( IXON | IXOFF | IXANY );
+    // Return immediately with whatever is available. Waiting is done with poll on the fd.
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    const speed_t speed = toSpeed( baud_rate );
+    if ( cfsetispeed( &tty, speed ) != 0 || cfsetospeed( &tty, speed ) != 0 )
+      throw std::runtime_error( "Unsupported baud rate: " + std::to_string( baud_rate ) );
+    if ( tcsetattr( fd_, TCSANOW, &tty ) != 0 )
+      throw std::runtime_error( std::string( "Failed to set serial port attributes: " ) +
+                                std::strerror( errno ) );
+    tcflush( fd_, TCIOFLUSH );
+
+    // Disable the driver's receive batching (usually 1-16 ms) where supported
+    serial_struct serial{};
+    if ( ioctl( fd_, TIOCGSERIAL, &serial ) == 0 ) {
+      serial.flags |= ASYNC_LOW_LATENCY;
+      low_latency_ = ioctl( fd_, TIOCSSERIAL, &serial ) == 0;
+    }
+  }
+
+  static speed_t toSpeed( int baud_rate )
+  {
+    switch ( baud_rate ) {
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+    case 230400:
+      return B230400;
+    case 460800:
+      return B460800;
+    case 921600:
+      return B921600;
+    default:
+      throw std::runtime_error( "Unsupported baud rate: " + std::to_string( baud_rate ) );
+    }
+  }
+
+  int fd_ = -1;
+  mutable bool drained_ = false;
+  bool low_latency_ = false;
+};
+} // namespace crosstalk
+
+#endif // CROSSTALK_TTY_SERIAL_HPP
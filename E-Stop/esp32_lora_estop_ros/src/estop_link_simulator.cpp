@@ -0,0 +1,587 @@
+// Discrete-event simulation of the wireless links between the E-Stop sender and the receiver.
+// The receiver side runs the EStopArbiter of the firmware against modeled links with loss, delay,
+// jitter and outages on a virtual clock and reports the latency from a button press to the output
+// of the receiver and the rate of false triggers.
+
+#include "esp32_lora_estop_ros/latency_statistics.hpp"
+
+#include <estop_arbiter.h>
+#include <lora_duty_cycle.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace esp32_lora_estop_ros
+{
+namespace
+{
+
+using SimTime = uint64_t; // us
+
+constexpr SimTime fromMs( double ms ) { return static_cast<SimTime>( ms * 1000 ); }
+
+constexpr double toMs( SimTime us ) { return us / 1000.0; }
+
+struct LinkModel {
+  const char *name;
+  CommTransport type;
+  double loss;
+  double delay_ms;
+  //! Uniformly distributed delay added on top of the delay.
+  double jitter_ms;
+  //! Mean time between the start of two outages, 0 disables outages.
+  double outage_interval_s;
+  double outage_duration_s;
+  double connection_timeout_ms = COMM_CONNECTION_TIMEOUT_MS;
+  double transmit_duration_ms = 0;
+  //! LoRa sends whenever the radio is free and the duty cycle allows it, each packet has the E-Stop
+  //! state at the start of the transmission. The other links send on every change and every resend
+  //! interval.
+  double airtime_ms = 0;
+  //! Duty-cycle budget of LoRa, see lora_duty_cycle.h. 0 sends back to back.
+  double duty_cycle_permille = 0;
+};
+
+struct Config {
+  double hours = 100;
+  double seed = 42;
+  double loop_ms = 1;
+  //! The sender resends the state if it did not change, see STATUS_UPDATE_INTERVAL_MS.
+  double resend_ms = 51;
+  //! After a press, the button is released while the state stays latched until Release. The sender
+  //! then sets its state in every loop iteration of this period.
+  double tap_ms = 200;
+  double sender_loop_ms = 1;
+  //! Minimum interval between two sequences of an unchanged state, see EStopSequencer.
+  double sequence_interval_ms = ESTOP_RESEND_INTERVAL_MS;
+  //! Mean time the E-Stop is released before it is pressed again.
+  double press_interval_s = 60;
+  //! Mean time the E-Stop is held active before it is released again, plus the minimum hold time.
+  double hold_s = 3;
+  double min_hold_s = 0.5;
+  LinkModel links[3] = {
+      { "lora", CommTransport::LORA, 0.05, 0, 1, 3600, 1, LORA_CONNECTION_TIMEOUT_MS,
+        LORA_TRANSMIT_DURATION_MS, 140, LORA_DUTY_CYCLE_PERMILLE },
+      { "ble", CommTransport::BLE, 0.01, 8, 30, 900, 5 },
+      { "esp_now", CommTransport::ESP_NOW, 0.02, 2, 3, 600, 2 },
+  };
+};
+
+//! The receiver end of a modeled link.
+class SimulatedTransport : public TransportInterface
+{
+public:
+  SimulatedTransport( const LinkModel &model, const unsigned long &now_ms )
+      : model_( model ), now_ms_( now_ms )
+  {
+  }
+
+  void receive( const PropertyValue &data )
+  {
+    data_ = data;
+    receive_time_ms_ = now_ms_;
+    ++receive_count_;
+  }
+
+  uint64_t receiveCount() const { return receive_count_; }
+
+  unsigned long receiveTime() const { return receive_time_ms_; }
+
+  CommTransport getTransportType() const override { return model_.type; }
+
+  void update() override { }
+
+  CommState getCommState() const override
+  {
+    return receive_count_ > 0 && now_ms_ - receive_time_ms_ < model_.connection_timeout_ms
+               ? CommState::CONNECTED
+               : CommState::DISCONNECTED;
+  }
+
+  float getRSSI() const override { return 0; }
+
+  unsigned long getTransmitDurationMs() const override
+  {
+    return static_cast<unsigned long>( model_.transmit_duration_ms );
+  }
+
+  bool sendsEveryUpdate() const override { return model_.airtime_ms <= 0; }
+
+  void setProperty( uint8_t, const PropertyValue & ) override { }
+
+  void readProperty( uint8_t id, PropertyValue &data, unsigned long &age_ms ) const override
+  {
+    data.clear();
+    age_ms = ULONG_MAX;
+    if ( id != COMM_PROPERTY_ID_ESTOP || receive_count_ == 0 )
+      return;
+    data = data_;
+    age_ms = now_ms_ - receive_time_ms_;
+  }
+
+private:
+  const LinkModel &model_;
+  const unsigned long &now_ms_;
+  PropertyValue data_;
+  unsigned long receive_time_ms_ = 0;
+  uint64_t receive_count_ = 0;
+};
+
+//! Alternating up and down times of a link with exponentially distributed durations.
+class OutageProcess
+{
+public:
+  OutageProcess( const LinkModel &model, std::mt19937_64 &rng ) : model_( model ), rng_( rng )
+  {
+    next_change_ = model_.outage_interval_s > 0 ? draw( model_.outage_interval_s ) : UINT64_MAX;
+  }
+
+  //! Has to be called with non-decreasing times.
+  bool isDown( SimTime time )
+  {
+    while ( time >= next_change_ ) {
+      down_ = !down_;
+      next_change_ += draw( down_ ? model_.outage_duration_s : model_.outage_interval_s );
+    }
+    return down_;
+  }
+
+private:
+  SimTime draw( double mean_s )
+  {
+    return fromMs( std::exponential_distribution<double>( 1.0 / mean_s )( rng_ ) * 1000 ) + 1;
+  }
+
+  const LinkModel &model_;
+  std::mt19937_64 &rng_;
+  SimTime next_change_;
+  bool down_ = false;
+};
+
+enum class EventType : uint8_t {
+  TOGGLE,
+  LATCH,
+  RESEND,
+  LORA_TRANSMIT,
+  DELIVER,
+  EXPIRE,
+  EVALUATE,
+};
+
+struct Event {
+  SimTime time;
+  EventType type;
+  uint8_t link = 0;
+  bool active = false;
+  uint8_t sequence = 0;
+  //! Send time for deliveries, the receive count of the link for expirations and the generation
+  //! for LoRa transmissions.
+  uint64_t value = 0;
+
+  bool operator>( const Event &other ) const { return time > other.time; }
+};
+
+class Simulation
+{
+public:
+  explicit Simulation( const Config &config )
+      : config_( config ), rng_( static_cast<uint64_t>( config.seed ) ),
+        loop_us_( std::max<SimTime>( 1, fromMs( config.loop_ms ) ) ),
+        sequencer_( static_cast<unsigned long>( config.sequence_interval_ms ) )
+  {
+    receivers_.reserve( 3 );
+    for ( size_t i = 0; i < 3; ++i ) {
+      receivers_.emplace_back( config_.links[i], now_ms_ );
+      outages_.emplace_back( config_.links[i], rng_ );
+      lora_senders_.push_back(
+          { LoraDutyCycle( static_cast<uint32_t>( config_.links[i].duty_cycle_permille ) ) } );
+      transports_[i] = &receivers_[i];
+    }
+  }
+
+  void run()
+  {
+    const SimTime end = fromMs( config_.hours * 3600 * 1000 );
+    // The receiver starts in the safe state, the initial release is not measured
+    startInterval( 0 );
+    for ( size_t i = 0; i < 3; ++i ) {
+      if ( config_.links[i].airtime_ms > 0 )
+        schedule( { 0, EventType::LORA_TRANSMIT, static_cast<uint8_t>( i ) } );
+    }
+    while ( !events_.empty() && events_.top().time < end ) {
+      const Event event = events_.top();
+      events_.pop();
+      handle( event );
+    }
+    if ( !sender_active_ )
+      released_us_ += end - released_start_;
+    if ( false_active_ )
+      false_active_us_ += end - false_active_start_;
+  }
+
+  void report( double wall_s ) const
+  {
+    const double hours = config_.hours;
+    std::printf( "Simulated %.0f h in %.1f s (%.0fx real time), %llu events\n", hours, wall_s,
+                 hours * 3600 / std::max( wall_s, 1e-9 ),
+                 static_cast<unsigned long long>( event_count_ ) );
+    printLatency( "Press to output", press_latency_ );
+    printLatency( "Release to output", release_latency_ );
+    std::printf( "False triggers: %llu (%.3f per hour), active %.4f%% of the released time\n",
+                 static_cast<unsigned long long>( false_triggers_ ), false_triggers_ / hours,
+                 100.0 * false_active_us_ / std::max<double>( released_us_, 1 ) );
+    std::printf( "Releases while pressed: %llu, presses never seen: %llu\n",
+                 static_cast<unsigned long long>( unsafe_releases_ ),
+                 static_cast<unsigned long long>( missed_presses_ ) );
+    for ( const LinkModel &link : config_.links ) {
+      const LinkStatistics &statistics = arbiter_.getStatistics( link.type );
+      std::printf( "%-8s received %lu, lost %lu, reordered %lu\n", link.name,
+                   static_cast<unsigned long>( statistics.received ),
+                   static_cast<unsigned long>( statistics.lost ),
+                   static_cast<unsigned long>( statistics.reordered ) );
+    }
+  }
+
+private:
+  static void printLatency( const char *name, const LatencyHistogram &histogram )
+  {
+    std::printf( "%s latency [ms] over %zu changes: p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, "
+                 "max %.1f\n",
+                 name, histogram.count(), histogram.quantile( 0.5 ), histogram.quantile( 0.9 ),
+                 histogram.quantile( 0.99 ), histogram.quantile( 0.999 ), histogram.max() );
+  }
+
+  void schedule( const Event &event ) { events_.push( event ); }
+
+  double uniform() { return std::uniform_real_distribution<double>( 0, 1 )( rng_ ); }
+
+  void handle( const Event &event )
+  {
+    ++event_count_;
+    switch ( event.type ) {
+    case EventType::TOGGLE:
+      toggle( event.time );
+      break;
+    case EventType::LATCH:
+      // The button was released, from now on it differs from the latched state
+      if ( event.value != resend_generation_ )
+        break;
+      latched_ = true;
+      send( event.time );
+      scheduleResend( event.time );
+      break;
+    case EventType::RESEND:
+      if ( event.value != resend_generation_ )
+        break;
+      send( event.time );
+      scheduleResend( event.time );
+      break;
+    case EventType::LORA_TRANSMIT:
+      if ( event.value == lora_senders_[event.link].generation )
+        transmitLora( event.link, event.time );
+      break;
+    case EventType::DELIVER:
+      deliver( event );
+      break;
+    case EventType::EXPIRE:
+      // A newer packet of the same link moved the expiration
+      if ( receivers_[event.link].receiveCount() == event.value )
+        requestEvaluation( event.time );
+      break;
+    case EventType::EVALUATE:
+      evaluate( event.time );
+      break;
+    }
+  }
+
+  void toggle( SimTime time )
+  {
+    sender_active_ = !sender_active_;
+    if ( sender_active_ ) {
+      released_us_ += time - released_start_;
+      // Already stopped, e.g., after a timeout
+      press_activation_time_ = time;
+    } else {
+      // The latency of a press is measured until the output was activated the last time. A packet
+      // sent before the press can still release the output after a timeout activated it.
+      if ( output_active_ )
+        press_latency_.add( toMs( press_activation_time_ - change_time_ ) );
+      else
+        ++missed_presses_;
+      released_start_ = time;
+      release_reported_ = !output_active_;
+    }
+    change_time_ = time;
+    startInterval( time );
+  }
+
+  //! Schedules the next change and sends the state immediately, restarting the resend interval.
+  void startInterval( SimTime time )
+  {
+    const double mean_s = sender_active_ ? config_.hold_s : config_.press_interval_s;
+    double duration_s = std::exponential_distribution<double>( 1.0 / mean_s )( rng_ );
+    if ( sender_active_ )
+      duration_s += config_.min_hold_s;
+    schedule( { time + fromMs( duration_s * 1000 ) + 1, EventType::TOGGLE } );
+    latched_ = false;
+    send( time );
+    ++resend_generation_;
+    scheduleResend( time );
+    if ( sender_active_ && config_.tap_ms < duration_s * 1000 )
+      schedule( { time + fromMs( config_.tap_ms ), EventType::LATCH, 0, false, 0,
+                  resend_generation_ } );
+  }
+
+  //! The sender sets its state every resend interval, or every loop while it is latched.
+  void scheduleResend( SimTime time )
+  {
+    const double interval_ms = latched_ ? config_.sender_loop_ms : config_.resend_ms;
+    schedule( { time + std::max<SimTime>( 1, fromMs( interval_ms ) ), EventType::RESEND, 0, false,
+                0, resend_generation_ } );
+  }
+
+  //! Sends the state with a new sequence like CommInterface, LoRa sends the latest with its next
+  //! packet.
+  void send( SimTime time )
+  {
+    if ( !sequencer_.update( sender_active_, static_cast<unsigned long>( time / 1000 ) ) )
+      return;
+    sequence_ = sequencer_.getSequence();
+    for ( size_t i = 0; i < 3; ++i ) {
+      if ( config_.links[i].airtime_ms <= 0 ) {
+        transmit( i, time, 0 );
+        continue;
+      }
+      LoraSender &sender = lora_senders_[i];
+      if ( sender.last_active == sender_active_ )
+        continue;
+      // A change is sent urgently once the radio is free, this replaces the pending periodic packet
+      sender.last_active = sender_active_;
+      sender.urgent_packets = LORA_URGENT_PACKETS;
+      ++sender.generation;
+      schedule( { std::max( time, sender.free_time ), EventType::LORA_TRANSMIT,
+                  static_cast<uint8_t>( i ), false, 0, sender.generation } );
+    }
+  }
+
+  //! Sends a LoRa packet if the duty cycle allows it, like LoraInterface on the server.
+  void transmitLora( size_t link, SimTime time )
+  {
+    const LinkModel &model = config_.links[link];
+    LoraSender &sender = lora_senders_[link];
+    const uint32_t airtime_us = static_cast<uint32_t>( fromMs( model.airtime_ms ) );
+    const uint32_t time_ms = static_cast<uint32_t>( time / 1000 );
+    const bool urgent = sender.urgent_packets > 0;
+    const uint32_t delay_ms = model.duty_cycle_permille > 0
+                                  ? sender.duty_cycle.getDelay( airtime_us, urgent, time_ms )
+                                  : 0;
+    if ( delay_ms > 0 ) {
+      schedule( { time + fromMs( delay_ms ), EventType::LORA_TRANSMIT, static_cast<uint8_t>( link ),
+                  false, 0, sender.generation } );
+      return;
+    }
+    if ( urgent )
+      --sender.urgent_packets;
+    sender.duty_cycle.addTransmission( airtime_us, time_ms );
+    transmit( link, time, airtime_us );
+    sender.free_time = time + airtime_us;
+    schedule( { sender.free_time, EventType::LORA_TRANSMIT, static_cast<uint8_t>( link ), false, 0,
+                sender.generation } );
+  }
+
+  void transmit( size_t link, SimTime time, SimTime airtime )
+  {
+    const LinkModel &model = config_.links[link];
+    if ( outages_[link].isDown( time ) || uniform() < model.loss )
+      return;
+    const SimTime delay = airtime + fromMs( model.delay_ms + model.jitter_ms * uniform() );
+    schedule( { time + delay, EventType::DELIVER, static_cast<uint8_t>( link ), sender_active_,
+                sequence_, time } );
+  }
+
+  void deliver( const Event &event )
+  {
+    setTime( event.time );
+    SimulatedTransport &receiver = receivers_[event.link];
+    receiver.receive( encodeEStopProperty( event.active, event.sequence,
+                                           static_cast<uint32_t>( event.value / 1000 ) ) );
+    const LinkModel &model = config_.links[event.link];
+    const SimTime receive_time = fromMs( receiver.receiveTime() );
+    const double stale_ms = ESTOP_TIMEOUT_MS + 1 - model.transmit_duration_ms;
+    schedule( { receive_time + fromMs( std::max( stale_ms, 0.0 ) ), EventType::EXPIRE, event.link,
+                false, 0, receiver.receiveCount() } );
+    schedule( { receive_time + fromMs( model.connection_timeout_ms ), EventType::EXPIRE,
+                event.link, false, 0, receiver.receiveCount() } );
+    requestEvaluation( event.time );
+  }
+
+  //! The receiver evaluates the links in its main loop, multiple changes are seen at once.
+  void requestEvaluation( SimTime time )
+  {
+    time = ( time + loop_us_ - 1 ) / loop_us_ * loop_us_;
+    if ( time == pending_evaluation_ )
+      return;
+    pending_evaluation_ = time;
+    schedule( { time, EventType::EVALUATE } );
+  }
+
+  void setTime( SimTime time ) { now_ms_ = static_cast<unsigned long>( time / 1000 ); }
+
+  void evaluate( SimTime time )
+  {
+    setTime( time );
+    arbiter_.update( transports_, 3, now_ms_ );
+    const bool active = arbiter_.isEStopActive();
+    if ( active == output_active_ )
+      return;
+    output_active_ = active;
+    if ( active ) {
+      if ( sender_active_ ) {
+        press_activation_time_ = time;
+      } else {
+        ++false_triggers_;
+        false_active_ = true;
+        false_active_start_ = time;
+      }
+    } else if ( sender_active_ ) {
+      ++unsafe_releases_;
+    } else if ( !release_reported_ ) {
+      release_latency_.add( toMs( time - change_time_ ) );
+      release_reported_ = true;
+    } else if ( false_active_ ) {
+      false_active_us_ += time - false_active_start_;
+      false_active_ = false;
+    }
+  }
+
+  const Config &config_;
+  std::mt19937_64 rng_;
+  SimTime loop_us_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  uint64_t event_count_ = 0;
+  SimTime pending_evaluation_ = UINT64_MAX;
+
+  unsigned long now_ms_ = 0;
+  std::vector<SimulatedTransport> receivers_;
+  std::vector<OutageProcess> outages_;
+  TransportInterface *transports_[3];
+  EStopArbiter arbiter_;
+
+  struct LoraSender {
+    LoraDutyCycle duty_cycle;
+    //! Only the latest scheduled transmission of a generation is handled.
+    uint64_t generation = 0;
+    SimTime free_time = 0;
+    uint8_t urgent_packets = 0;
+    bool last_active = false;
+  };
+  std::vector<LoraSender> lora_senders_;
+
+  bool sender_active_ = false;
+  //! The state differs from the buttons, the sender sets it in every loop.
+  bool latched_ = false;
+  EStopSequencer sequencer_;
+  uint8_t sequence_ = 0;
+  SimTime change_time_ = 0;
+  uint64_t resend_generation_ = 0;
+  bool output_active_ = true;
+  SimTime press_activation_time_ = 0;
+  bool release_reported_ = false;
+
+  LatencyHistogram press_latency_;
+  LatencyHistogram release_latency_;
+  uint64_t false_triggers_ = 0;
+  uint64_t unsafe_releases_ = 0;
+  uint64_t missed_presses_ = 0;
+  bool false_active_ = false;
+  SimTime false_active_start_ = 0;
+  SimTime false_active_us_ = 0;
+  SimTime released_start_ = 0;
+  SimTime released_us_ = 0;
+};
+
+struct Option {
+  std::string name;
+  double *value;
+};
+
+std::vector<Option> options( Config &config )
+{
+  std::vector<Option> result = {
+      { "hours", &config.hours },
+      { "seed", &config.seed },
+      { "loop_ms", &config.loop_ms },
+      { "resend_ms", &config.resend_ms },
+      { "tap_ms", &config.tap_ms },
+      { "sender_loop_ms", &config.sender_loop_ms },
+      { "sequence_interval_ms", &config.sequence_interval_ms },
+      { "press_interval_s", &config.press_interval_s },
+      { "hold_s", &config.hold_s },
+      { "min_hold_s", &config.min_hold_s },
+  };
+  for ( LinkModel &link : config.links ) {
+    const std::string prefix = std::string( link.name ) + ".";
+    result.push_back( { prefix + "loss", &link.loss } );
+    result.push_back( { prefix + "delay_ms", &link.delay_ms } );
+    result.push_back( { prefix + "jitter_ms", &link.jitter_ms } );
+    result.push_back( { prefix + "outage_interval_s", &link.outage_interval_s } );
+    result.push_back( { prefix + "outage_duration_s", &link.outage_duration_s } );
+    result.push_back( { prefix + "connection_timeout_ms", &link.connection_timeout_ms } );
+    result.push_back( { prefix + "transmit_duration_ms", &link.transmit_duration_ms } );
+    if ( link.airtime_ms <= 0 )
+      continue;
+    result.push_back( { prefix + "airtime_ms", &link.airtime_ms } );
+    result.push_back( { prefix + "duty_cycle_permille", &link.duty_cycle_permille } );
+  }
+  return result;
+}
+
+void printUsage( const char *program, Config &config )
+{
+  std::printf( "Usage: %s [name=value]...\n\nOptions and their defaults:\n", program );
+  for ( const Option &option : options( config ) )
+    std::printf( "  %-32s %g\n", option.name.c_str(), *option.value );
+  std::printf( "\nThe E-Stop timeout of %lu ms is compiled into the arbiter.\n", ESTOP_TIMEOUT_MS );
+}
+} // namespace
+} // namespace esp32_lora_estop_ros
+
+int main( int argc, char **argv )
+{
+  using namespace esp32_lora_estop_ros;
+  Config config;
+  std::vector<Option> config_options = options( config );
+  for ( int i = 1; i < argc; ++i ) {
+    const char *separator = std::strchr( argv[i], '=' );
+    const Option *option = nullptr;
+    if ( separator != nullptr ) {
+      const std::string name( argv[i], separator - argv[i] );
+      for ( const Option &candidate : config_options ) {
+        if ( candidate.name == name )
+          option = &candidate;
+      }
+    }
+    char *end = nullptr;
+    const double value = option != nullptr ? std::strtod( separator + 1, &end ) : 0;
+    if ( option == nullptr || end == separator + 1 || *end != '\0' ) {
+      printUsage( argv[0], config );
+      return std::strcmp( argv[i], "--help" ) == 0 ? 0 : 1;
+    }
+    *option->value = value;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  Simulation simulation( config );
+  simulation.run();
+  const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+  simulation.report( wall.count() );
+  return 0;
+}
@@ -0,0 +1,408 @@
+// Measures the latency of E-Stop frames from the receiver firmware to the host under status
+// flooding. A device thread emulates the host communication of the receiver firmware on one end
+// of a pseudo terminal: frames are queued in a PriorityTxQueue, or a plain FIFO for comparison,
+// and written at the rate of the serial line. A reader thread handles them like the
+// receiver_interface_node, i.e., it waits using poll, handles every E-Stop state as it is read,
+// keeps only the newest status and runs with the same real-time priority and CPU affinity options.
+
+#include "esp32_lora_estop_ros/latency_statistics.hpp"
+
+#include <host_comm.h>
+
+#include "crosstalk_mirrored_ring_storage.hpp"
+#include "crosstalk_tty_serial.hpp"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace esp32_lora_estop_ros
+{
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+  double duration_s = 10;
+  //! Rate of the emulated serial line. The pseudo terminal itself is not rate limited.
+  double baud_rate = 115200;
+  //! Interval of E-Stop frames, the firmware sends one for every packet received from the sender.
+  double estop_interval_ms = 20;
+  //! Interval of status frames. 0 floods the line, i.e., a status frame is queued whenever a slot
+  //! is free.
+  double status_interval_ms = 0;
+  //! 1 to flush by priority like the firmware, 0 to send all frames in the order they were queued.
+  double priority = 1;
+  //! Space in the TX buffer of the USB CDC or UART driver of the ESP32. Frames larger than this,
+  //! e.g., the 100 bytes of EStopReceiverStatus, are never sent.
+  double tx_buffer_bytes = 256;
+  //! TX buffer that status frames leave free for E-Stop frames with priority=1. The default leaves
+  //! room for one status frame in the default TX buffer like the firmware.
+  double reserved_bytes = 156;
+  //! Options of the reader thread, see the reader_thread parameters of the receiver_interface_node.
+  double realtime_priority = 0;
+  double cpu_affinity = -1;
+  //! Threads busy looping at normal priority to load the CPUs. The device thread runs with the
+  //! highest real-time priority, if permitted, to not be affected.
+  double load_threads = 0;
+};
+
+//! Time stamps of an E-Stop frame, identified by its trace sequence.
+struct FrameTimes {
+  std::atomic<int64_t> queued_ns{ 0 };
+  std::atomic<int64_t> written_ns{ 0 };
+};
+
+int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now().time_since_epoch() )
+      .count();
+}
+
+void configureThread( int realtime_priority, int cpu_affinity, const char *name )
+{
+  if ( cpu_affinity >= 0 ) {
+    cpu_set_t cpu_set;
+    CPU_ZERO( &cpu_set );
+    CPU_SET( cpu_affinity, &cpu_set );
+    const int result = pthread_setaffinity_np( pthread_self(), sizeof( cpu_set ), &cpu_set );
+    if ( result != 0 )
+      std::fprintf( stderr, "Failed to pin %s thread to CPU %d: %s\n", name, cpu_affinity,
+                    std::strerror( result ) );
+  }
+  if ( realtime_priority > 0 ) {
+    sched_param param{};
+    param.sched_priority = std::min( realtime_priority, sched_get_priority_max( SCHED_FIFO ) );
+    const int result = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+    if ( result != 0 )
+      std::fprintf( stderr, "Failed to set real-time priority %d for %s thread: %s\n",
+                    param.sched_priority, name, std::strerror( result ) );
+  }
+}
+
+/*!
+ * Emulates the serial port of the receiver firmware. Frames flushed from the TX queue are placed in
+ * a TX buffer of limited size that is written to the pseudo terminal at the rate of the line.
+ */
+class DeviceSerial
+{
+public:
+  DeviceSerial( int fd, const Config &config, std::array<FrameTimes, 256> &times )
+      : fd_( fd ), capacity_( static_cast<size_t>( config.tx_buffer_bytes ) ),
+        bytes_per_second_( config.baud_rate / 10 ), times_( times )
+  {
+  }
+
+  //! Used by PriorityTxQueue::flush.
+  int availableForWrite() const { return static_cast<int>( capacity_ - buffer_.size() ); }
+
+  void sendFrame( const uint8_t *frame, size_t size )
+  {
+    buffer_.insert( buffer_.end(), frame, frame + size );
+    queued_bytes_ += size;
+    if ( frame[2] == crosstalk::object_id<EStopState>() )
+      estop_frames_.push_back( { queued_bytes_, getSequence( frame, size ) } );
+  }
+
+  //! Writes the bytes that were transmitted on the line since the last call.
+  void transmit( Clock::time_point now )
+  {
+    budget_ += std::chrono::duration<double>( now - last_transmit_ ).count() * bytes_per_second_;
+    last_transmit_ = now;
+    size_t count = std::min( buffer_.size(), static_cast<size_t>( budget_ ) );
+    if ( buffer_.empty() )
+      budget_ = 0; // The line was idle
+    else
+      budget_ -= count;
+    uint8_t chunk[256];
+    while ( count > 0 ) {
+      const size_t size = std::min( count, sizeof( chunk ) );
+      std::copy( buffer_.begin(), buffer_.begin() + size, chunk );
+      const ssize_t written = ::write( fd_, chunk, size );
+      if ( written <= 0 )
+        break; // The reader fell behind, the pseudo terminal buffer is full
+      buffer_.erase( buffer_.begin(), buffer_.begin() + written );
+      written_bytes_ += written;
+      count -= written;
+    }
+    const int64_t written_ns = nowNs();
+    while ( !estop_frames_.empty() && estop_frames_.front().end <= written_bytes_ ) {
+      times_[estop_frames_.front().sequence].written_ns.store( written_ns );
+      estop_frames_.pop_front();
+    }
+  }
+
+private:
+  static uint8_t getSequence( const uint8_t *frame, size_t size )
+  {
+    EStopState state;
+    crosstalk::util::SegmentedReader reader( frame + 6, size - 8 );
+    crosstalk::util::deserialize( reader, state );
+    return state.trace.sequence;
+  }
+
+  struct PendingFrame {
+    uint64_t end;
+    uint8_t sequence;
+  };
+
+  int fd_;
+  size_t capacity_;
+  double bytes_per_second_;
+  std::array<FrameTimes, 256> &times_;
+  std::deque<uint8_t> buffer_;
+  std::deque<PendingFrame> estop_frames_;
+  uint64_t queued_bytes_ = 0;
+  uint64_t written_bytes_ = 0;
+  double budget_ = 0;
+  Clock::time_point last_transmit_ = Clock::now();
+};
+
+constexpr size_t SLOT_SIZE = ReceiverToHostObjects::max_frame_size();
+
+//! The receiver firmware: queues E-Stop and status frames and flushes them to the serial port.
+void runDevice( int fd, const Config &config, std::array<FrameTimes, 256> &times,
+                const std::atomic<bool> &running, uint64_t &dropped )
+{
+  // The device is separate hardware and must not be delayed by the load on the host
+  configureThread( sched_get_priority_max( SCHED_FIFO ), -1, "device" );
+  DeviceSerial serial( fd, config, times );
+  crosstalk::PriorityTxQueue<SLOT_SIZE, 8> priority_queue(
+      static_cast<int>( config.reserved_bytes ) );
+  crosstalk::TxQueue<SLOT_SIZE, 8> fifo_queue;
+  const auto push = [&]( const auto &obj ) {
+    const auto result = config.priority > 0 ? priority_queue.push( obj ) : fifo_queue.push( obj );
+    return result == crosstalk::WriteResult::Success;
+  };
+  const auto estop_interval = std::chrono::duration<double, std::milli>( config.estop_interval_ms );
+  const auto status_interval =
+      std::chrono::duration<double, std::milli>( config.status_interval_ms );
+  auto next_estop = Clock::now();
+  auto next_status = Clock::now();
+  uint8_t sequence = 0;
+  while ( running.load( std::memory_order_relaxed ) ) {
+    const auto now = Clock::now();
+    if ( now >= next_estop ) {
+      next_estop += std::chrono::duration_cast<Clock::duration>( estop_interval );
+      EStopState state{};
+      state.trace.sequence = ++sequence;
+      times[sequence].written_ns.store( 0 );
+      times[sequence].queued_ns.store( nowNs() );
+      dropped += !push( state );
+    }
+    if ( now >= next_status ) {
+      if ( config.status_interval_ms > 0 ) {
+        next_status += std::chrono::duration_cast<Clock::duration>( status_interval );
+        push( EStopReceiverStatus{} );
+      } else {
+        while ( push( EStopReceiverStatus{} ) ) {
+        }
+      }
+    }
+    if ( config.priority > 0 ) {
+      priority_queue.flush( serial );
+    } else {
+      const uint8_t *frame;
+      size_t size;
+      while ( fifo_queue.peek( frame, size ) &&
+              static_cast<int>( size ) <= serial.availableForWrite() ) {
+        serial.sendFrame( frame, size );
+        fifo_queue.pop();
+      }
+    }
+    serial.transmit( now );
+    // The loop of the firmware runs about every ms
+    std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+  }
+}
+
+struct Results {
+  LatencyHistogram queue;  //!< From queueing on the device until the last byte was on the line.
+  LatencyHistogram host;   //!< From the last byte on the line until handled by the reader.
+  LatencyHistogram total;  //!< From queueing on the device until handled by the reader.
+  uint64_t status_frames = 0;
+  uint64_t errors = 0;
+};
+
+//! The reader thread of the receiver_interface_node.
+void runReader( const std::string &device, int stop_fd, const Config &config,
+                std::array<FrameTimes, 256> &times, Results &results )
+{
+  configureThread( static_cast<int>( config.realtime_priority ),
+                   static_cast<int>( config.cpu_affinity ), "reader" );
+  auto serial = std::make_unique<crosstalk::TtySerial>( device, 115200 );
+  const int serial_fd = serial->fd();
+  crosstalk::CrossTalker<4096, 128, crosstalk::MirroredRingStorage> talker( std::move( serial ) );
+  const auto handler = crosstalk::overloaded{
+      [&]( const EStopState &state ) {
+        const int64_t handled_ns = nowNs();
+        const FrameTimes &frame_times = times[state.trace.sequence];
+        const int64_t queued_ns = frame_times.queued_ns.load();
+        const int64_t written_ns = frame_times.written_ns.load();
+        if ( written_ns == 0 || written_ns < queued_ns )
+          return; // Overwritten by a later frame with the same sequence
+        results.queue.add( ( written_ns - queued_ns ) / 1e6 );
+        results.host.add( ( handled_ns - written_ns ) / 1e6 );
+        results.total.add( ( handled_ns - queued_ns ) / 1e6 );
+      },
+      [&]( const EStopReceiverStatus & ) { ++results.status_frames; },
+      []( const LogRecord & ) {} };
+  while ( true ) {
+    pollfd fds[2] = { { serial_fd, POLLIN, 0 }, { stop_fd, POLLIN, 0 } };
+    if ( poll( fds, 2, 100 ) == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      std::fprintf( stderr, "Polling failed: %s\n", std::strerror( errno ) );
+      return;
+    }
+    if ( fds[1].revents != 0 )
+      return;
+    talker.processSerialData();
+    // Like the node, E-Stop states are handled as they are read and only the newest status
+    ReceiverToHostObjects::Latest latest;
+    const auto dispatcher = crosstalk::overloaded{
+        [&]( const EStopState &state ) { handler( state ); },
+        [&]( const auto &obj ) { latest( obj ); } };
+    while ( true ) {
+      const crosstalk::ReadResult result = ReceiverToHostObjects::dispatch( talker, dispatcher );
+      if ( result == crosstalk::ReadResult::NoObjectAvailable ||
+           result == crosstalk::ReadResult::NotEnoughData )
+        break;
+      results.errors += result != crosstalk::ReadResult::Success;
+    }
+    latest.dispatch( handler );
+  }
+}
+
+struct Option {
+  std::string name;
+  double *value;
+};
+
+std::vector<Option> options( Config &config )
+{
+  return {
+      { "duration_s", &config.duration_s },
+      { "baud_rate", &config.baud_rate },
+      { "estop_interval_ms", &config.estop_interval_ms },
+      { "status_interval_ms", &config.status_interval_ms },
+      { "priority", &config.priority },
+      { "tx_buffer_bytes", &config.tx_buffer_bytes },
+      { "reserved_bytes", &config.reserved_bytes },
+      { "realtime_priority", &config.realtime_priority },
+      { "cpu_affinity", &config.cpu_affinity },
+      { "load_threads", &config.load_threads },
+  };
+}
+
+void printUsage( const char *program, Config &config )
+{
+  std::printf( "Usage: %s [name=value]...\n\nOptions and their defaults:\n", program );
+  for ( const Option &option : options( config ) )
+    std::printf( "  %-32s %g\n", option.name.c_str(), *option.value );
+}
+
+void printHistogram( const char *name, const LatencyHistogram &histogram )
+{
+  std::printf( "  %-8s p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", name, histogram.quantile( 0.5 ),
+               histogram.quantile( 0.99 ), histogram.max() );
+}
+} // namespace
+} // namespace esp32_lora_estop_ros
+
+int main( int argc, char **argv )
+{
+  using namespace esp32_lora_estop_ros;
+  Config config;
+  std::vector<Option> config_options = options( config );
+  for ( int i = 1; i < argc; ++i ) {
+    const char *separator = std::strchr( argv[i], '=' );
+    const Option *option = nullptr;
+    if ( separator != nullptr ) {
+      const std::string name( argv[i], separator - argv[i] );
+      for ( const Option &candidate : config_options ) {
+        if ( candidate.name == name )
+          option = &candidate;
+      }
+    }
+    char *end = nullptr;
+    const double value = option != nullptr ? std::strtod( separator + 1, &end ) : 0;
+    if ( option == nullptr || end == separator + 1 || *end != '\0' ) {
+      printUsage( argv[0], config );
+      return std::strcmp( argv[i], "--help" ) == 0 ? 0 : 1;
+    }
+    *option->value = value;
+  }
+
+  const int master_fd = posix_openpt( O_RDWR | O_NOCTTY | O_CLOEXEC );
+  if ( master_fd == -1 || grantpt( master_fd ) != 0 || unlockpt( master_fd ) != 0 ) {
+    std::fprintf( stderr, "Failed to create pseudo terminal: %s\n", std::strerror( errno ) );
+    return 1;
+  }
+  const std::string device = ptsname( master_fd );
+  fcntl( master_fd, F_SETFL, fcntl( master_fd, F_GETFL ) | O_NONBLOCK );
+  const int stop_fd = eventfd( 0, EFD_CLOEXEC );
+
+  std::array<FrameTimes, 256> times;
+  Results results;
+  std::atomic<bool> running{ true };
+  std::vector<std::thread> load;
+  for ( int i = 0; i < static_cast<int>( config.load_threads ); ++i ) {
+    load.emplace_back( [&running] {
+      volatile uint64_t counter = 0;
+      while ( running.load( std::memory_order_relaxed ) ) counter = counter + 1;
+    } );
+  }
+  std::thread reader;
+  try {
+    // Opened before the device starts writing, so no frame is lost
+    reader = std::thread( [&] { runReader( device, stop_fd, config, times, results ); } );
+  } catch ( const std::exception &e ) {
+    std::fprintf( stderr, "%s\n", e.what() );
+    return 1;
+  }
+  std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+  uint64_t dropped = 0;
+  std::thread device_thread( [&] { runDevice( master_fd, config, times, running, dropped ); } );
+  std::this_thread::sleep_for( std::chrono::duration<double>( config.duration_s ) );
+  running = false;
+  device_thread.join();
+  const uint64_t value = 1;
+  if ( write( stop_fd, &value, sizeof( value ) ) != sizeof( value ) )
+    std::fprintf( stderr, "Failed to stop the reader: %s\n", std::strerror( errno ) );
+  reader.join();
+  for ( auto &thread : load ) thread.join();
+  close( stop_fd );
+  close( master_fd );
+
+  std::printf( "%s flush, %g baud, E-Stop every %g ms, status ",
+               config.priority > 0 ? "Priority" : "FIFO", config.baud_rate,
+               config.estop_interval_ms );
+  if ( config.status_interval_ms > 0 )
+    std::printf( "every %g ms", config.status_interval_ms );
+  else
+    std::printf( "flooding" );
+  std::printf( ", %zu E-Stop and %llu status frames, %llu dropped, %llu errors\n",
+               results.total.count(), static_cast<unsigned long long>( results.status_frames ),
+               static_cast<unsigned long long>( dropped ),
+               static_cast<unsigned long long>( results.errors ) );
+  printHistogram( "queue", results.queue );
+  printHistogram( "host", results.host );
+  printHistogram( "total", results.total );
+  return results.total.count() > 0 ? 0 : 1;
+}
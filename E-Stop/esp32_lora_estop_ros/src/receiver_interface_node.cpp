@@ -1,24 +1,54 @@
 #include "esp32_lora_estop_ros/receiver_interface_node.hpp"
 #include "host_comm.h"
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <functional>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
-#include "crosstalk_lib_serial_wrapper.hpp"
+#include "crosstalk_mirrored_ring_storage.hpp"
+#include "crosstalk_tty_serial.hpp"
 
 #include <rclcpp_components/register_node_macro.hpp>
 RCLCPP_COMPONENTS_REGISTER_NODE( esp32_lora_estop_ros::ReceiverInterfaceNode )
 
 namespace esp32_lora_estop_ros
 {
+static_assert( HostToReceiverObjects::max_frame_size() <= 128,
+               "TX queue slots are too small for the host to receiver objects." );
+static_assert( ReceiverToHostObjects::max_frame_size() <= 4096,
+               "Receive buffer is too small for the receiver to host objects." );
 
 ReceiverInterfaceNode::ReceiverInterfaceNode( const rclcpp::NodeOptions &options )
-    : LifecycleNode( "receiver_interface_node", options )
+    : LifecycleNode( "receiver_interface_node", options ),
+      tx_queue_( std::make_unique<crosstalk::TxQueue<128, 16>>() )
 {
+  tx_event_fd_ = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+  if ( tx_event_fd_ == -1 )
+    throw std::runtime_error( std::string( "Failed to create event fd: " ) + std::strerror( errno ) );
 
   int startup_state = lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE;
   declare_readonly_parameter( "startup_state", startup_state, "Initial lifecycle state" );
   declare_readonly_parameter(
       "serial_port", port_, "Serial port to use for communication with the ESP32 LoRa E-Stop device" );
+  declare_readonly_parameter( "baud_rate", baud_rate_, "Baud rate of the serial port" );
+  declare_readonly_parameter( "max_objects_per_cycle", max_objects_per_cycle_,
+                              "Maximum number of objects processed in one loop cycle" );
+  declare_readonly_parameter( "statistics_period", statistics_period_,
+                              "Period in seconds for logging queue statistics. 0 to disable." );
+  declare_readonly_parameter(
+      "latency_diagnostics_period", latency_diagnostics_period_,
+      "Period in seconds for publishing E-Stop latency histograms on /diagnostics. 0 to disable." );
+  max_objects_per_cycle_ = std::max( max_objects_per_cycle_, 1 );
+  declare_readonly_parameter(
+      "reader_thread.realtime_priority", reader_realtime_priority_,
+      "SCHED_FIFO priority (1-99) of the serial reader thread. 0 to disable." );
+  declare_readonly_parameter( "reader_thread.cpu_affinity", reader_cpu_affinity_,
+                              "CPU core the serial reader thread is pinned to. -1 to disable." );
   if ( startup_state > lifecycle_msgs::msg::State::PRIMARY_STATE_UNCONFIGURED )
     trigger_transition( lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE );
   if ( startup_state > lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE )
@@ -29,14 +59,27 @@ ReceiverInterfaceNode::ReceiverInterfaceNode( const rclcpp::NodeOptions &options
               std::shared_ptr<esp32_lora_estop_interface::srv::SetEnabled::Response> ) {
         RCLCPP_INFO( get_logger(), "SetEnabled command received: %s",
                      request->enabled ? "ENABLED" : "DISABLED" );
-        auto result = cross_talker_->sendObject( SetEnabledCommand{ request->enabled } );
+        // Queued and sent by the reader thread which is the only one using the cross talker
+        auto result = tx_queue_->push( SetEnabledCommand{ request->enabled } );
         if ( result != crosstalk::WriteResult::Success ) {
           RCLCPP_ERROR( get_logger(), "Failed to send SetEnabled command: %s",
                         crosstalk::to_string( result ).c_str() );
+          return;
+        }
+        const uint64_t value = 1;
+        if ( write( tx_event_fd_, &value, sizeof( value ) ) != sizeof( value ) ) {
+          RCLCPP_ERROR( get_logger(), "Failed to notify reader thread: %s", std::strerror( errno ) );
         }
       } );
 }
 
+ReceiverInterfaceNode::~ReceiverInterfaceNode()
+{
+  stopReaderThread();
+  if ( tx_event_fd_ != -1 )
+    close( tx_event_fd_ );
+}
+
 void ReceiverInterfaceNode::setup()
 {
 
@@ -52,6 +95,9 @@ void ReceiverInterfaceNode::setup()
 
   deadman_comm_status_publisher_ = create_publisher<esp32_lora_estop_interface::msg::CommStatus>(
       "remote_estop/deadman_comm_status", rclcpp::QoS( 1 ).reliable().transient_local() );
+
+  diagnostics_publisher_ =
+      create_publisher<diagnostic_msgs::msg::DiagnosticArray>( "/diagnostics", rclcpp::QoS( 10 ) );
 }
 
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
@@ -78,11 +124,16 @@ ReceiverInterfaceNode::on_activate( const rclcpp_lifecycle::State &state )
   soft_estop_publisher_->on_activate();
   remote_comm_status_publisher_->on_activate();
   deadman_comm_status_publisher_->on_activate();
+  diagnostics_publisher_->on_activate();
 
   estop_publisher_->publish( std_msgs::msg::Bool().set__data( true ) );
   soft_estop_publisher_->publish( { std_msgs::msg::Bool().set__data( true ) } );
-  // timer for periodic loop
-  loop_timer_ = create_wall_timer( std::chrono::milliseconds( 50 ), [this] { loopCallback(); } );
+  last_drained_time_ = std::chrono::steady_clock::now();
+  statistics_ = QueueStatistics();
+  statistics_start_time_ = last_drained_time_;
+  latency_ = LatencyStatistics();
+  latency_start_time_ = last_drained_time_;
+  startReaderThread();
 
   return rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn::SUCCESS;
 }
@@ -94,11 +145,12 @@ ReceiverInterfaceNode::on_deactivate( const rclcpp_lifecycle::State &state )
   RCLCPP_INFO( get_logger(), "Deactivating to enter 'inactive' state from '%s' state",
                state.label().c_str() );
 
+  stopReaderThread();
   estop_publisher_->on_deactivate();
   soft_estop_publisher_->on_deactivate();
   remote_comm_status_publisher_->on_deactivate();
   deadman_comm_status_publisher_->on_deactivate();
-  loop_timer_->cancel();
+  diagnostics_publisher_->on_deactivate();
 
   return rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn::SUCCESS;
 }
@@ -114,10 +166,10 @@ ReceiverInterfaceNode::on_cleanup( const rclcpp_lifecycle::State &state )
   soft_estop_publisher_.reset();
   remote_comm_status_publisher_.reset();
   deadman_comm_status_publisher_.reset();
+  diagnostics_publisher_.reset();
+  stopReaderThread();
   cross_talker_.reset();
-  if ( serial_port_ )
-    serial_port_->Close();
-  serial_port_.reset();
+  serial_fd_ = -1;
 
   return rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn::SUCCESS;
 }
@@ -138,15 +190,17 @@ ReceiverInterfaceNode::on_shutdown( const rclcpp_lifecycle::State &state )
 }
 void ReceiverInterfaceNode::initSerialPort()
 {
-  if ( serial_port_ && serial_port_->IsOpen() ) {
+  if ( cross_talker_ ) {
     RCLCPP_INFO( get_logger(), "Serial port already open, skipping initialization." );
     return;
   }
   RCLCPP_INFO( get_logger(), "Opening serial port: %s", port_.c_str() );
-  serial_port_ = std::make_unique<LibSerial::SerialPort>();
-  serial_port_->Open( port_ );
-  cross_talker_ = std::make_unique<crosstalk::CrossTalker<2048, 128>>(
-      std::make_unique<crosstalk::LibSerialWrapper>( *serial_port_ ) );
+  auto serial = std::make_unique<crosstalk::TtySerial>( port_, baud_rate_ );
+  if ( !serial->lowLatency() )
+    RCLCPP_INFO( get_logger(), "Serial driver does not support low latency mode." );
+  serial_fd_ = serial->fd();
+  cross_talker_ = std::make_unique<crosstalk::CrossTalker<4096, 128, crosstalk::MirroredRingStorage>>(
+      std::move( serial ) );
 }
 
 namespace
@@ -161,73 +215,390 @@ esp32_lora_estop_interface::msg::CommStatus toMsg( const CommStatus &status )
   msg.esp_now_connection_status = static_cast<uint8_t>( status.esp_now_state );
   msg.radio_connection_status = static_cast<uint8_t>( status.radio_state );
   msg.last_message_age_ms = status.last_received_message_age_ms;
+  msg.ble_received = status.ble_statistics.received;
+  msg.ble_lost = status.ble_statistics.lost;
+  msg.ble_reordered = status.ble_statistics.reordered;
+  msg.esp_now_received = status.esp_now_statistics.received;
+  msg.esp_now_lost = status.esp_now_statistics.lost;
+  msg.esp_now_reordered = status.esp_now_statistics.reordered;
+  msg.radio_received = status.radio_statistics.received;
+  msg.radio_lost = status.radio_statistics.lost;
+  msg.radio_reordered = status.radio_statistics.reordered;
   return msg;
 }
+
+void logRecord( const rclcpp::Logger &node_logger, const LogRecord &record )
+{
+  char text[256];
+  formatLogRecord( record, text, sizeof( text ) );
+  const rclcpp::Logger logger =
+      node_logger.get_child( std::string( "receiver." ) + logSubsystemName( record.subsystem ) );
+  switch ( record.level ) {
+  case LogLevel::DEBUG:
+    RCLCPP_DEBUG( logger, "%s", text );
+    break;
+  case LogLevel::INFO:
+    RCLCPP_INFO( logger, "%s", text );
+    break;
+  case LogLevel::WARNING:
+    RCLCPP_WARN( logger, "%s", text );
+    break;
+  default:
+    RCLCPP_ERROR( logger, "%s", text );
+    break;
+  }
+}
 } // namespace
 
-void ReceiverInterfaceNode::loopCallback()
+bool ReceiverInterfaceNode::processObjects()
 {
   if ( !cross_talker_ ) {
-    return;
+    return true;
   }
+  bool drained = false;
   try {
-    cross_talker_->processSerialData();
-    if ( cross_talker_->available() ) {
-      std::vector<uint8_t> buffer;
-      buffer.resize( cross_talker_->available() );
-      cross_talker_->read( buffer.data(), buffer.size() );
-      std::cout << reinterpret_cast<char *>( buffer.data() );
-    }
-    if ( cross_talker_->hasObject() ) {
-      int16_t object_id = cross_talker_->getObjectId();
-      switch ( object_id ) {
-      case crosstalk::object_id<EStopState>(): {
-        EStopState estop_state;
-        if ( cross_talker_->readObject( estop_state ) == crosstalk::ReadResult::Success ) {
-          if ( first_publish_ || estop_state_ != estop_state.hard_estop_active ) {
-            estop_state_ = estop_state.hard_estop_active;
-            estop_publisher_->publish( std_msgs::msg::Bool().set__data( estop_state_ ) );
-            RCLCPP_INFO( get_logger(), "Hard E-Stop state changed: %s",
-                         estop_state_ ? "ACTIVE" : "INACTIVE" );
-          }
-          if ( first_publish_ || soft_estop_state_ != estop_state.soft_estop_active ) {
-            soft_estop_state_ = estop_state.soft_estop_active;
-            soft_estop_publisher_->publish( std_msgs::msg::Bool().set__data( soft_estop_state_ ) );
-            RCLCPP_INFO( get_logger(), "Soft E-Stop state changed: %s",
-                         soft_estop_state_ ? "ACTIVE" : "INACTIVE" );
-          }
-          first_publish_ = false;
-        }
-        break;
+    const auto wakeup_time = std::chrono::steady_clock::now();
+    // Drain all complete frames up to the budget to avoid E-Stop state changes queueing up behind
+    // status frames. E-Stop states and log records are handled as they are read, so every
+    // transition is published even if a batch contains an activation followed by a release.
+    // Only the newest status is published.
+    int frames = 0;
+    ReceiverToHostObjects::Latest latest;
+    std::chrono::steady_clock::time_point frame_time;
+    const auto handler = [&]( const auto &obj ) {
+      using T = std::decay_t<decltype( obj )>;
+      if constexpr ( std::is_same_v<T, LogRecord> ) {
+        logRecord( get_logger(), obj );
+      } else if constexpr ( std::is_same_v<T, EStopState> ) {
+        handleEStopState( obj, frame_time );
+      } else {
+        latest( obj );
       }
-      case crosstalk::object_id<EStopReceiverStatus>(): {
-        EStopReceiverStatus estop_status;
-
-        if ( cross_talker_->readObject( estop_status ) == crosstalk::ReadResult::Success ) {
-          esp32_lora_estop_interface::msg::CommStatus remote_msg =
-              toMsg( estop_status.remote_status );
-          remote_comm_status_publisher_->publish( remote_msg );
-          esp32_lora_estop_interface::msg::CommStatus deadman_msg =
-              toMsg( estop_status.deadman_status );
-          deadman_comm_status_publisher_->publish( deadman_msg );
-        } else {
-          RCLCPP_WARN( get_logger(), "Failed to read CommStatus object" );
-        }
+    };
+    cross_talker_->processSerialData();
+    while ( frames < max_objects_per_cycle_ ) {
+      if ( cross_talker_->available() )
+        readText();
+      frame_time = std::chrono::steady_clock::now();
+      const bool is_estop_state =
+          cross_talker_->getObjectId() == crosstalk::object_id<EStopState>();
+      const crosstalk::ReadResult result =
+          ReceiverToHostObjects::dispatch( *cross_talker_, handler, [this]( int16_t id ) {
+            RCLCPP_WARN( get_logger(), "Received object with unknown ID: %d", id );
+          } );
+      if ( result == crosstalk::ReadResult::NoObjectAvailable ||
+           result == crosstalk::ReadResult::NotEnoughData ) {
+        // Everything buffered was processed. Data that arrived in the meantime wakes the next poll.
+        drained = true;
         break;
       }
-      default:
-        RCLCPP_WARN( get_logger(), "Received object with unknown ID: %d", object_id );
-        break;
+      ++frames;
+      // Frames arrived after the port was last drained, hence, this is an upper bound of the delay
+      const double delay_ms =
+          std::chrono::duration<double, std::milli>( frame_time - last_drained_time_ ).count();
+      statistics_.frames += 1;
+      statistics_.sum_delay_ms += delay_ms;
+      statistics_.max_delay_ms = std::max( statistics_.max_delay_ms, delay_ms );
+      if ( is_estop_state )
+        statistics_.max_estop_delay_ms = std::max( statistics_.max_estop_delay_ms, delay_ms );
+      if ( result == crosstalk::ReadResult::CrcError ||
+           result == crosstalk::ReadResult::ObjectSizeMismatch ) {
+        RCLCPP_WARN( get_logger(), "Failed to read object: %s",
+                     crosstalk::to_string( result ).c_str() );
       }
     }
+    latest.dispatch(
+        crosstalk::overloaded{
+            []( const EStopState & ) {
+              // Handled immediately, never stored in latest
+            },
+            [this]( const EStopReceiverStatus &estop_status ) {
+              esp32_lora_estop_interface::msg::CommStatus remote_msg =
+                  toMsg( estop_status.remote_status );
+              remote_comm_status_publisher_->publish( remote_msg );
+              esp32_lora_estop_interface::msg::CommStatus deadman_msg =
+                  toMsg( estop_status.deadman_status );
+              deadman_comm_status_publisher_->publish( deadman_msg );
+            },
+            []( const LogRecord & ) {
+              // Handled immediately, never stored in latest
+            } } );
+    if ( drained ) {
+      last_drained_time_ = wakeup_time;
+    } else {
+      ++statistics_.budget_exhausted;
+      RCLCPP_WARN_THROTTLE( get_logger(), *get_clock(), 5000,
+                            "Processed %d objects in one cycle, remaining objects are delayed.",
+                            frames );
+    }
+    ++statistics_.cycles;
+    statistics_.max_frames_per_cycle = std::max( statistics_.max_frames_per_cycle, frames );
+    reportStatistics( wakeup_time );
+    publishLatencyDiagnostics( wakeup_time );
     error_count_ = 0;
   } catch ( std::runtime_error &e ) {
     if ( ++error_count_ > 5 ) {
+      RCLCPP_ERROR( get_logger(), "Closing serial port after repeated errors: %s", e.what() );
       cross_talker_.reset();
-      serial_port_.reset();
+      serial_fd_ = -1;
       error_count_ = 0;
     }
+    return true;
+  }
+  return drained;
+}
+
+void ReceiverInterfaceNode::readText()
+{
+  uint8_t chunk[128];
+  size_t count;
+  while ( ( count = cross_talker_->read( chunk, sizeof( chunk ) ) ) > 0 ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      const char c = static_cast<char>( chunk[i] );
+      if ( c != '\n' && c != '\r' )
+        text_line_[text_line_size_++] = c;
+      if ( c != '\n' && text_line_size_ < text_line_.size() )
+        continue;
+      if ( text_line_size_ > 0 ) {
+        RCLCPP_INFO( get_logger().get_child( "receiver" ), "%.*s",
+                     static_cast<int>( text_line_size_ ), text_line_.data() );
+      }
+      text_line_size_ = 0;
+    }
+  }
+}
+
+void ReceiverInterfaceNode::handleEStopState( const EStopState &estop_state,
+                                              std::chrono::steady_clock::time_point receive_time )
+{
+  if ( first_publish_ || estop_state_ != estop_state.hard_estop_active ) {
+    estop_state_ = estop_state.hard_estop_active;
+    estop_publisher_->publish( std_msgs::msg::Bool().set__data( estop_state_ ) );
+    RCLCPP_INFO( get_logger(), "Hard E-Stop state changed: %s",
+                 estop_state_ ? "ACTIVE" : "INACTIVE" );
+  }
+  if ( first_publish_ || soft_estop_state_ != estop_state.soft_estop_active ) {
+    soft_estop_state_ = estop_state.soft_estop_active;
+    soft_estop_publisher_->publish( std_msgs::msg::Bool().set__data( soft_estop_state_ ) );
+    RCLCPP_INFO( get_logger(), "Soft E-Stop state changed: %s",
+                 soft_estop_state_ ? "ACTIVE" : "INACTIVE" );
+  }
+  first_publish_ = false;
+  recordLatency( estop_state, receive_time, std::chrono::steady_clock::now() );
+}
+
+void ReceiverInterfaceNode::startReaderThread()
+{
+  stopReaderThread();
+  stop_event_fd_ = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+  if ( stop_event_fd_ == -1 ) {
+    RCLCPP_ERROR( get_logger(), "Failed to create event fd for reader thread: %s",
+                  std::strerror( errno ) );
+    return;
+  }
+  reader_thread_ = std::thread( [this] { readerThreadLoop(); } );
+}
+
+void ReceiverInterfaceNode::stopReaderThread()
+{
+  if ( reader_thread_.joinable() ) {
+    const uint64_t value = 1;
+    if ( write( stop_event_fd_, &value, sizeof( value ) ) != sizeof( value ) ) {
+      RCLCPP_ERROR( get_logger(), "Failed to signal reader thread: %s", std::strerror( errno ) );
+    }
+    reader_thread_.join();
   }
+  if ( stop_event_fd_ != -1 ) {
+    close( stop_event_fd_ );
+    stop_event_fd_ = -1;
+  }
+}
+
+void ReceiverInterfaceNode::configureReaderThread()
+{
+  if ( reader_cpu_affinity_ >= 0 ) {
+    cpu_set_t cpu_set;
+    CPU_ZERO( &cpu_set );
+    CPU_SET( reader_cpu_affinity_, &cpu_set );
+    const int result = pthread_setaffinity_np( pthread_self(), sizeof( cpu_set ), &cpu_set );
+    if ( result != 0 ) {
+      RCLCPP_WARN( get_logger(), "Failed to pin reader thread to CPU %d: %s",
+                   reader_cpu_affinity_, std::strerror( result ) );
+    }
+  }
+  if ( reader_realtime_priority_ > 0 ) {
+    sched_param param{};
+    param.sched_priority =
+        std::min( reader_realtime_priority_, sched_get_priority_max( SCHED_FIFO ) );
+    const int result = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+    if ( result != 0 ) {
+      RCLCPP_WARN( get_logger(),
+                   "Failed to set real-time priority %d for reader thread: %s. Check rtprio limits.",
+                   param.sched_priority, std::strerror( result ) );
+    }
+  }
+}
+
+void ReceiverInterfaceNode::readerThreadLoop()
+{
+  configureReaderThread();
+  const int serial_fd = serial_fd_;
+  if ( serial_fd == -1 ) {
+    RCLCPP_ERROR( get_logger(), "Serial port not open, reader thread not started." );
+    return;
+  }
+  bool drained = true;
+  while ( true ) {
+    pollfd fds[3] = { { serial_fd, POLLIN, 0 },
+                      { stop_event_fd_, POLLIN, 0 },
+                      { tx_event_fd_, POLLIN, 0 } };
+    // Objects left over due to the budget are processed without waiting for new data.
+    int result = poll( fds, 3, 0 );
+    if ( result == 0 && drained ) {
+      // Nothing pending, hence, new data is processed as soon as it arrives.
+      // The timeout keeps the statistics updated if no data arrives.
+      result = poll( fds, 3, 100 );
+      if ( result > 0 )
+        last_drained_time_ = std::chrono::steady_clock::now();
+    }
+    if ( result == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      RCLCPP_ERROR( get_logger(), "Polling serial port failed: %s", std::strerror( errno ) );
+      break;
+    }
+    if ( fds[1].revents != 0 )
+      break;
+    if ( fds[2].revents != 0 ) {
+      uint64_t value;
+      if ( read( tx_event_fd_, &value, sizeof( value ) ) != sizeof( value ) && errno != EAGAIN ) {
+        RCLCPP_ERROR( get_logger(), "Failed to read tx event fd: %s", std::strerror( errno ) );
+      }
+    }
+    if ( !cross_talker_ ) {
+      RCLCPP_ERROR( get_logger(), "Serial port closed, stopping reader thread." );
+      break;
+    }
+    if ( fds[0].revents & ( POLLERR | POLLHUP | POLLNVAL ) ) {
+      RCLCPP_ERROR( get_logger(), "Serial port %s disconnected, stopping reader thread.",
+                    port_.c_str() );
+      cross_talker_.reset();
+      serial_fd_ = -1;
+      break;
+    }
+    sendQueuedObjects();
+    drained = processObjects();
+  }
+}
+
+void ReceiverInterfaceNode::sendQueuedObjects()
+{
+  try {
+    tx_queue_->drain( [this]( const uint8_t *frame, size_t size ) {
+      cross_talker_->sendFrame( frame, size );
+    } );
+  } catch ( std::runtime_error &e ) {
+    RCLCPP_ERROR( get_logger(), "Failed to send queued objects: %s", e.what() );
+  }
+}
+
+void ReceiverInterfaceNode::reportStatistics( std::chrono::steady_clock::time_point now )
+{
+  if ( statistics_period_ <= 0 ||
+       std::chrono::duration<double>( now - statistics_start_time_ ).count() < statistics_period_ )
+    return;
+  RCLCPP_INFO( get_logger(),
+               "Processed %zu objects in %zu cycles (max %d per cycle, budget exhausted %zu times). "
+               "Queueing delay: mean %.1f ms, max %.1f ms, max E-Stop state %.1f ms.",
+               statistics_.frames, statistics_.cycles, statistics_.max_frames_per_cycle,
+               statistics_.budget_exhausted,
+               statistics_.frames > 0 ? statistics_.sum_delay_ms / statistics_.frames : 0.0,
+               statistics_.max_delay_ms, statistics_.max_estop_delay_ms );
+  statistics_ = QueueStatistics();
+  statistics_start_time_ = now;
+}
+
+void ReceiverInterfaceNode::recordLatency( const EStopState &state,
+                                           std::chrono::steady_clock::time_point receive_time,
+                                           std::chrono::steady_clock::time_point publish_time )
+{
+  const EStopTrace &trace = state.trace;
+  if ( trace.transport == CommTransport::NONE )
+    return; // Sender does not support tracing
+  const double host_ms =
+      std::chrono::duration<double, std::milli>( publish_time - receive_time ).count();
+  const double receive_ms =
+      std::chrono::duration<double, std::milli>( receive_time.time_since_epoch() ).count();
+  const double serial_ms =
+      serial_clock_offset_.update( receive_ms - state.send_time_ms, receive_time );
+  latency_.serial.add( serial_ms );
+  latency_.host.add( host_ms );
+  // The receiver resends the last state periodically, only the first arrival of a trace is recorded
+  // The sequence wraps after 256 resends, i.e., 12.8 s, and restarts with the sender, so it only
+  // identifies the trace together with the receive time.
+  if ( has_last_trace_ && trace.receive_time_ms == last_trace_receive_time_ms_ &&
+       trace.sequence == last_trace_sequence_ )
+    return;
+  // The sender also takes a new sequence for every resend of an unchanged state, see
+  // EStopSequencer, so changes are detected using the state
+  const bool state_changed = has_last_trace_ && state.hard_estop_active != last_trace_active_;
+  has_last_trace_ = true;
+  last_trace_receive_time_ms_ = trace.receive_time_ms;
+  last_trace_sequence_ = trace.sequence;
+  last_trace_active_ = state.hard_estop_active;
+
+  // Unsigned differences of the 32 bit device clocks are correct across their wrap-around
+  const double receiver_ms = static_cast<int32_t>( state.send_time_ms - trace.receive_time_ms );
+  latency_.receiver.add( receiver_ms );
+  if ( !trace.sender_time_valid )
+    return;
+  const double radio_ms = radio_clock_offset_.update(
+      static_cast<int32_t>( trace.receive_time_ms - trace.sender_time_ms ), receive_time );
+  latency_.radio.add( radio_ms );
+  const double total_ms = radio_ms + receiver_ms + serial_ms + host_ms;
+  latency_.total.add( total_ms );
+  if ( state_changed )
+    latency_.state_change.add( total_ms );
+}
+
+void ReceiverInterfaceNode::publishLatencyDiagnostics( std::chrono::steady_clock::time_point now )
+{
+  if ( latency_diagnostics_period_ <= 0 ||
+       std::chrono::duration<double>( now - latency_start_time_ ).count() <
+           latency_diagnostics_period_ )
+    return;
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.name = std::string( get_name() ) + ": E-Stop latency";
+  status.hardware_id = port_;
+  status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status.message = latency_.total.count() > 0 ? "Latencies in ms, radio and serial are relative "
+                                                "to the fastest delivery"
+                                              : "No traced E-Stop states received";
+  const auto add_histogram = [&status]( const std::string &name,
+                                        const LatencyHistogram &histogram ) {
+    const auto add_value = [&status, &name]( const std::string &key, double value ) {
+      diagnostic_msgs::msg::KeyValue key_value;
+      key_value.key = name + "." + key;
+      key_value.value = std::to_string( value );
+      status.values.push_back( key_value );
+    };
+    add_value( "count", histogram.count() );
+    add_value( "p50", histogram.quantile( 0.5 ) );
+    add_value( "p99", histogram.quantile( 0.99 ) );
+    add_value( "max", histogram.max() );
+  };
+  add_histogram( "radio", latency_.radio );
+  add_histogram( "receiver", latency_.receiver );
+  add_histogram( "serial", latency_.serial );
+  add_histogram( "host", latency_.host );
+  add_histogram( "total", latency_.total );
+  add_histogram( "state_change", latency_.state_change );
+  diagnostic_msgs::msg::DiagnosticArray msg;
+  msg.header.stamp = get_clock()->now();
+  msg.status.push_back( std::move( status ) );
+  diagnostics_publisher_->publish( msg );
+  latency_ = LatencyStatistics();
+  latency_start_time_ = now;
 }
 
 } // namespace esp32_lora_estop_ros
@@ -0,0 +1,34 @@
+// Throughput of the CRC16 backends of crosstalk on the host.
+// Built with CROSSTALK_CRC16_SLICE_BY_8, which provides the tables for the table and all sliced
+// variants. The ESP ROM backend can only be measured on the target.
+
+#include <crosstalk.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+using namespace crosstalk::util;
+
+namespace
+{
+template<uint16_t ( *UPDATE )( uint16_t, const uint8_t *, size_t )>
+void BM_Crc16( benchmark::State &state )
+{
+  std::vector<uint8_t> data( state.range( 0 ) );
+  std::mt19937 rng( 42 );
+  for ( auto &value : data ) value = static_cast<uint8_t>( rng() );
+  for ( auto _ : state ) {
+    benchmark::DoNotOptimize( data.data() );
+    benchmark::DoNotOptimize( UPDATE( crc16::initial_value, data.data(), data.size() ) );
+  }
+  state.SetBytesProcessed( static_cast<int64_t>( state.iterations() ) * state.range( 0 ) );
+}
+} // namespace
+
+// 8 bytes is a frame without payload, 64 bytes a typical status frame.
+BENCHMARK_TEMPLATE( BM_Crc16, &crc16::update_bitwise )->RangeMultiplier( 8 )->Range( 8, 4096 );
+BENCHMARK_TEMPLATE( BM_Crc16, &crc16::update_table )->RangeMultiplier( 8 )->Range( 8, 4096 );
+BENCHMARK_TEMPLATE( BM_Crc16, &crc16::update_sliced<4> )->RangeMultiplier( 8 )->Range( 8, 4096 );
+BENCHMARK_TEMPLATE( BM_Crc16, &crc16::update_sliced<8> )->RangeMultiplier( 8 )->Range( 8, 4096 );
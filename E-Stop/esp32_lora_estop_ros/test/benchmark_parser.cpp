@@ -0,0 +1,107 @@
+// Throughput of the incremental frame parser of the CrossTalker.
+// Data arrives in small chunks like from the serial port and the buffer is inspected after every
+// chunk like in the reader thread of the receiver_interface_node. Every byte is scanned only once,
+// hence, the throughput does not depend on how much debug text is already buffered.
+
+#include <crosstalk.hpp>
+#include <host_comm.h>
+
+#include "crosstalk_mirrored_ring_storage.hpp"
+#include "loopback_serial.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace
+{
+using esp32_lora_estop_ros::LoopbackSerial;
+
+constexpr size_t CHUNK_SIZE = 16;
+
+//! Writes the data in chunks and polls the talker after each chunk.
+template<typename Talker>
+void feed( LoopbackSerial &serial, Talker &talker, const uint8_t *data, size_t size )
+{
+  for ( size_t offset = 0; offset < size; offset += CHUNK_SIZE ) {
+    serial.write( data + offset, std::min( CHUNK_SIZE, size - offset ) );
+    talker.processSerialData();
+    benchmark::DoNotOptimize( talker.hasObject() );
+    benchmark::DoNotOptimize( talker.available() );
+  }
+}
+
+/*!
+ * Debug text of state.range( 0 ) bytes followed by an EStopState frame.
+ * The text stays buffered until the frame arrived, so a parser that rescans the buffer gets slower
+ * the more text is buffered.
+ */
+template<template<int> class RingStorage>
+void BM_FrameAfterDebugText( benchmark::State &state )
+{
+  using Talker = crosstalk::CrossTalker<4096, 128, RingStorage>;
+  LoopbackSerial *serial;
+  auto talker = esp32_lora_estop_ros::makeLoopbackTalker<Talker>( serial );
+  std::vector<uint8_t> text( state.range( 0 ) );
+  for ( size_t i = 0; i < text.size(); ++i )
+    text[i] = i % 64 == 63 ? '\n' : static_cast<uint8_t>( 'a' + i % 26 );
+  uint8_t frame[ReceiverToHostObjects::max_frame_size()];
+  size_t frame_size = 0;
+  crosstalk::serializeFrame( EStopState{}, frame, sizeof( frame ), frame_size );
+  std::vector<uint8_t> read_buffer( text.size() );
+  for ( auto _ : state ) {
+    feed( *serial, *talker, text.data(), text.size() );
+    feed( *serial, *talker, frame, frame_size );
+    talker->read( read_buffer.data(), read_buffer.size() );
+    EStopState obj;
+    if ( talker->readObject( obj ) != crosstalk::ReadResult::Success ) {
+      state.SkipWithError( "Failed to read the frame" );
+      break;
+    }
+  }
+  state.SetBytesProcessed( static_cast<int64_t>( state.iterations() ) *
+                           static_cast<int64_t>( text.size() + frame_size ) );
+}
+
+//! A stream of back to back EStopState and EStopReceiverStatus frames dispatched by type.
+template<template<int> class RingStorage>
+void BM_DispatchFrames( benchmark::State &state )
+{
+  using Talker = crosstalk::CrossTalker<4096, 128, RingStorage>;
+  LoopbackSerial *serial;
+  auto talker = esp32_lora_estop_ros::makeLoopbackTalker<Talker>( serial );
+  std::vector<uint8_t> stream;
+  uint8_t frame[ReceiverToHostObjects::max_frame_size()];
+  size_t frame_size = 0;
+  for ( int i = 0; i < 16; ++i ) {
+    if ( i % 4 == 0 )
+      crosstalk::serializeFrame( EStopReceiverStatus{}, frame, sizeof( frame ), frame_size );
+    else
+      crosstalk::serializeFrame( EStopState{}, frame, sizeof( frame ), frame_size );
+    stream.insert( stream.end(), frame, frame + frame_size );
+  }
+  size_t frames = 0;
+  for ( auto _ : state ) {
+    for ( size_t offset = 0; offset < stream.size(); offset += 64 ) {
+      serial->write( stream.data() + offset, std::min<size_t>( 64, stream.size() - offset ) );
+      talker->processSerialData();
+      while ( ReceiverToHostObjects::dispatch( *talker, [&]( const auto & ) { ++frames; } ) ==
+              crosstalk::ReadResult::Success ) {
+      }
+    }
+  }
+  if ( frames != 16 * static_cast<size_t>( state.iterations() ) )
+    state.SkipWithError( "Not all frames were dispatched" );
+  state.SetItemsProcessed( static_cast<int64_t>( frames ) );
+  state.SetBytesProcessed( static_cast<int64_t>( state.iterations() * stream.size() ) );
+}
+} // namespace
+
+BENCHMARK_TEMPLATE( BM_FrameAfterDebugText, crosstalk::ArrayRingStorage )
+    ->RangeMultiplier( 4 )
+    ->Range( 64, 4096 - 64 );
+BENCHMARK_TEMPLATE( BM_FrameAfterDebugText, crosstalk::MirroredRingStorage )
+    ->RangeMultiplier( 4 )
+    ->Range( 64, 4096 - 64 );
+BENCHMARK_TEMPLATE( BM_DispatchFrames, crosstalk::ArrayRingStorage );
+BENCHMARK_TEMPLATE( BM_DispatchFrames, crosstalk::MirroredRingStorage );
@@ -0,0 +1,169 @@
+// Serialization cost per object of crosstalk on the host.
+// Compares the single-pass serialization with the memcpy fast path against walking the fields and
+// against computing the size in a separate pass first, which is what sendObject used to do.
+// The label of each benchmark states whether the type is copied with a single memcpy. Types with
+// padding between their fields, like most of the host_comm.h objects, are serialized per field.
+// The fast path is only available with GCC, see CROSSTALK_MEMCPY_LAYOUT. With other compilers, all
+// types are labeled per field and the memcpy benchmarks measure the per field path.
+
+#include <crosstalk.hpp>
+#include <host_comm.h>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+//! Fixed layout without padding, serialized with a single memcpy.
+struct PackedSample {
+  uint32_t time_ms;
+  uint32_t received;
+  uint32_t lost;
+  uint32_t reordered;
+  uint16_t voltage_mv;
+  uint16_t current_ma;
+  int8_t ble_rssi;
+  int8_t radio_rssi;
+  int8_t esp_now_rssi;
+  uint8_t flags;
+};
+
+REFL_AUTO( type( PackedSample, crosstalk::id( 0x40 ) ), field( time_ms ), field( received ),
+           field( lost ), field( reordered ), field( voltage_mv ), field( current_ma ),
+           field( ble_rssi ), field( radio_rssi ), field( esp_now_rssi ), field( flags ) )
+
+//! Variable length, the size is only known after serializing.
+struct VariableSample {
+  std::string name;
+  std::vector<uint16_t> values;
+};
+
+REFL_AUTO( type( VariableSample, crosstalk::id( 0x41 ) ), field( name ), field( values ) )
+
+namespace
+{
+using namespace crosstalk::util;
+
+template<typename T>
+T makeObject()
+{
+  if constexpr ( std::is_same_v<T, VariableSample> ) {
+    return { "receiver", std::vector<uint16_t>( 16, 42 ) };
+  } else {
+    return T{};
+  }
+}
+
+template<typename T>
+void setLabel( benchmark::State &state )
+{
+  state.SetLabel( is_memcpy_layout<T>() ? "memcpy" : "per field" );
+}
+
+//! The generic path without the memcpy fast path for the top level type.
+template<typename T>
+size_t serializeFieldwise( BufferWriter &writer, const T &obj )
+{
+  size_t offset = 0;
+  refl::util::for_each( refl::reflect( obj ).members,
+                        [&]( auto &&member ) { offset += serialize( writer, member( obj ) ); } );
+  return offset;
+}
+
+template<typename T>
+void BM_Serialize( benchmark::State &state )
+{
+  T obj = makeObject<T>();
+  uint8_t buffer[256];
+  benchmark::DoNotOptimize( buffer );
+  for ( auto _ : state ) {
+    benchmark::DoNotOptimize( obj );
+    BufferWriter writer( buffer, sizeof( buffer ) );
+    benchmark::DoNotOptimize( serialize( writer, obj ) );
+    benchmark::ClobberMemory();
+  }
+  setLabel<T>( state );
+  state.SetItemsProcessed( state.iterations() );
+}
+
+template<typename T>
+void BM_SerializeFieldwise( benchmark::State &state )
+{
+  T obj = makeObject<T>();
+  uint8_t buffer[256];
+  benchmark::DoNotOptimize( buffer );
+  for ( auto _ : state ) {
+    benchmark::DoNotOptimize( obj );
+    BufferWriter writer( buffer, sizeof( buffer ) );
+    benchmark::DoNotOptimize( serializeFieldwise( writer, obj ) );
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed( state.iterations() );
+}
+
+template<typename T>
+void BM_SerializeTwoPass( benchmark::State &state )
+{
+  T obj = makeObject<T>();
+  uint8_t buffer[256];
+  benchmark::DoNotOptimize( buffer );
+  for ( auto _ : state ) {
+    benchmark::DoNotOptimize( obj );
+    const size_t size = compute_size( obj );
+    benchmark::DoNotOptimize( size );
+    BufferWriter writer( buffer, sizeof( buffer ) );
+    benchmark::DoNotOptimize( serializeFieldwise( writer, obj ) );
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed( state.iterations() );
+}
+
+//! Complete frame including header and CRC as sent by sendObject and TxQueue::push.
+template<typename T>
+void BM_SerializeFrame( benchmark::State &state )
+{
+  T obj = makeObject<T>();
+  uint8_t buffer[256];
+  size_t size = 0;
+  benchmark::DoNotOptimize( buffer );
+  for ( auto _ : state ) {
+    benchmark::DoNotOptimize( obj );
+    benchmark::DoNotOptimize( crosstalk::serializeFrame( obj, buffer, sizeof( buffer ), size ) );
+    benchmark::ClobberMemory();
+  }
+  setLabel<T>( state );
+  state.SetItemsProcessed( state.iterations() );
+}
+
+template<typename T>
+void BM_Deserialize( benchmark::State &state )
+{
+  const T obj = makeObject<T>();
+  uint8_t buffer[256];
+  BufferWriter writer( buffer, sizeof( buffer ) );
+  const size_t size = serialize( writer, obj );
+  benchmark::DoNotOptimize( buffer );
+  for ( auto _ : state ) {
+    benchmark::ClobberMemory();
+    T result;
+    SegmentedReader reader( buffer, size );
+    benchmark::DoNotOptimize( deserialize( reader, result ) );
+    benchmark::DoNotOptimize( result );
+  }
+  setLabel<T>( state );
+  state.SetItemsProcessed( state.iterations() );
+}
+} // namespace
+
+#define SERIALIZATION_BENCHMARKS( T )                                                              \
+  BENCHMARK_TEMPLATE( BM_Serialize, T );                                                           \
+  BENCHMARK_TEMPLATE( BM_SerializeFieldwise, T );                                                  \
+  BENCHMARK_TEMPLATE( BM_SerializeTwoPass, T );                                                    \
+  BENCHMARK_TEMPLATE( BM_SerializeFrame, T );                                                      \
+  BENCHMARK_TEMPLATE( BM_Deserialize, T )
+
+SERIALIZATION_BENCHMARKS( PackedSample );
+SERIALIZATION_BENCHMARKS( EStopState );
+SERIALIZATION_BENCHMARKS( EStopReceiverStatus );
+SERIALIZATION_BENCHMARKS( LogRecord );
+SERIALIZATION_BENCHMARKS( VariableSample );
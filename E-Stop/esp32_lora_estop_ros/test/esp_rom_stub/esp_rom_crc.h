@@ -0,0 +1,23 @@
+// Host replacement for the ESP32 ROM CRC routines to test the CROSSTALK_CRC16_ESP_ROM backend.
+// Behaves as documented in esp_rom_crc.h of ESP-IDF: the CRC is inverted before and after
+// processing the data, and the polynomial is 0x1021 processed MSB first.
+
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+#include <cstdint>
+
+inline uint16_t esp_rom_crc16_be( uint16_t crc, uint8_t const *buf, uint32_t len )
+{
+  crc = ~crc;
+  for ( uint32_t i = 0; i < len; ++i ) {
+    crc ^= static_cast<uint16_t>( buf[i] << 8 );
+    for ( int bit = 0; bit < 8; ++bit ) {
+      crc = ( crc & 0x8000 ) ? static_cast<uint16_t>( ( crc << 1 ) ^ 0x1021 )
+                             : static_cast<uint16_t>( crc << 1 );
+    }
+  }
+  return ~crc;
+}
+
+#endif // ESP_ROM_CRC_H
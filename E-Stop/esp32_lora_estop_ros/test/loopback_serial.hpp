@@ -0,0 +1,68 @@
+// In-memory serial port for the host tests and benchmarks of crosstalk.
+
+#ifndef ESP32_LORA_ESTOP_ROS_TEST_LOOPBACK_SERIAL_HPP
+#define ESP32_LORA_ESTOP_ROS_TEST_LOOPBACK_SERIAL_HPP
+
+#include <crosstalk.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace esp32_lora_estop_ros
+{
+
+/*!
+ * Bytes written to the port can be read back from the same port. The buffer has a fixed capacity
+ * and is allocated on construction, so writing and reading does not allocate.
+ * Writes that do not fit are truncated like a full TX buffer of a serial port.
+ */
+class LoopbackSerial : public crosstalk::SerialAbstraction
+{
+public:
+  explicit LoopbackSerial( size_t capacity = 1 << 16 ) : buffer_( capacity ) { }
+
+  int available() const override { return static_cast<int>( size_ ); }
+
+  int read( uint8_t *data, size_t length ) override
+  {
+    length = std::min( length, size_ );
+    for ( size_t i = 0; i < length; ++i ) {
+      data[i] = buffer_[head_];
+      head_ = head_ + 1 == buffer_.size() ? 0 : head_ + 1;
+    }
+    size_ -= length;
+    return static_cast<int>( length );
+  }
+
+  void write( const uint8_t *data, size_t length ) override
+  {
+    length = std::min( length, buffer_.size() - size_ );
+    size_t tail = ( head_ + size_ ) % buffer_.size();
+    for ( size_t i = 0; i < length; ++i ) {
+      buffer_[tail] = data[i];
+      tail = tail + 1 == buffer_.size() ? 0 : tail + 1;
+    }
+    size_ += length;
+  }
+
+  int availableForWrite() const override { return static_cast<int>( buffer_.size() - size_ ); }
+
+private:
+  std::vector<uint8_t> buffer_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+//! Creates a talker reading from the given port. The port is owned by the talker.
+template<typename Talker>
+std::unique_ptr<Talker> makeLoopbackTalker( LoopbackSerial *&serial, size_t capacity = 1 << 16 )
+{
+  auto port = std::make_unique<LoopbackSerial>( capacity );
+  serial = port.get();
+  return std::make_unique<Talker>( std::move( port ) );
+}
+
+} // namespace esp32_lora_estop_ros
+
+#endif // ESP32_LORA_ESTOP_ROS_TEST_LOOPBACK_SERIAL_HPP
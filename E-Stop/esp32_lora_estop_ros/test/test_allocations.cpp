@@ -0,0 +1,267 @@
+// Counts heap allocations on the hot paths of crosstalk and the property exchange of the firmware.
+// Replaces the global operator new, hence, this has to stay the only test in its binary.
+
+#include <crosstalk.hpp>
+#include <estop_arbiter.h>
+#include <host_comm.h>
+#include <spsc_queue.h>
+
+#include "loopback_serial.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+namespace
+{
+std::atomic<size_t> allocation_count{ 0 };
+
+void *countedAllocate( size_t size )
+{
+  allocation_count.fetch_add( 1, std::memory_order_relaxed );
+  if ( void *ptr = std::malloc( size == 0 ? 1 : size ) )
+    return ptr;
+  throw std::bad_alloc();
+}
+} // namespace
+
+void *operator new( size_t size ) { return countedAllocate( size ); }
+void *operator new[]( size_t size ) { return countedAllocate( size ); }
+void *operator new( size_t size, const std::nothrow_t & ) noexcept
+{
+  allocation_count.fetch_add( 1, std::memory_order_relaxed );
+  return std::malloc( size == 0 ? 1 : size );
+}
+void *operator new[]( size_t size, const std::nothrow_t &tag ) noexcept
+{
+  return operator new( size, tag );
+}
+void operator delete( void *ptr ) noexcept { std::free( ptr ); }
+void operator delete[]( void *ptr ) noexcept { std::free( ptr ); }
+void operator delete( void *ptr, size_t ) noexcept { std::free( ptr ); }
+void operator delete[]( void *ptr, size_t ) noexcept { std::free( ptr ); }
+
+struct ArenaObject {
+  uint32_t number;
+  std::string_view name;
+  crosstalk::Span<uint16_t> values;
+};
+
+REFL_AUTO( type( ArenaObject, crosstalk::id( 0x32 ) ), field( number ), field( name ),
+           field( values ) )
+
+namespace
+{
+using esp32_lora_estop_ros::LoopbackSerial;
+using Talker = crosstalk::CrossTalker<1024, 256>;
+
+//! Number of allocations made by the function.
+template<typename Function>
+size_t countAllocations( Function &&function )
+{
+  const size_t before = allocation_count.load( std::memory_order_relaxed );
+  function();
+  return allocation_count.load( std::memory_order_relaxed ) - before;
+}
+} // namespace
+
+TEST( Allocations, CounterDetectsAllocations )
+{
+  EXPECT_GT( countAllocations( [] { delete new int( 1 ); } ), 0u );
+}
+
+TEST( Allocations, ArenaDeserializationDoesNotAllocate )
+{
+  LoopbackSerial *serial;
+  auto talker = esp32_lora_estop_ros::makeLoopbackTalker<Talker>( serial );
+  crosstalk::StaticArena<256> arena;
+  uint16_t values[16];
+  uint8_t frame[256];
+  size_t received = 0;
+  uint32_t checksum = 0;
+  const size_t allocations = countAllocations( [&] {
+    for ( uint32_t i = 0; i < 1000; ++i ) {
+      for ( uint16_t k = 0; k < 16; ++k ) values[k] = static_cast<uint16_t>( i + k );
+      const ArenaObject sent{ i, "arena object", crosstalk::Span<uint16_t>( values, i % 17 ) };
+      size_t size = 0;
+      if ( crosstalk::serializeFrame( sent, frame, sizeof( frame ), size ) !=
+           crosstalk::WriteResult::Success )
+        continue;
+      serial->write( frame, size );
+      talker->processSerialData();
+      ArenaObject obj{};
+      arena.reset();
+      if ( talker->readObject( obj, arena ) != crosstalk::ReadResult::Success )
+        continue;
+      ++received;
+      checksum += obj.number + obj.name.size();
+      for ( uint16_t value : obj.values ) checksum += value;
+    }
+  } );
+  EXPECT_EQ( allocations, 0u );
+  EXPECT_EQ( received, 1000u );
+  EXPECT_GT( checksum, 0u );
+}
+
+TEST( Allocations, CorruptLengthIsRejectedWithoutAllocating )
+{
+  LoopbackSerial *serial;
+  auto talker = esp32_lora_estop_ros::makeLoopbackTalker<Talker>( serial );
+  crosstalk::StaticArena<256> arena;
+  uint16_t values[4] = { 1, 2, 3, 4 };
+  const ArenaObject sent{ 7, "name", crosstalk::Span<uint16_t>( values, 4 ) };
+  uint8_t frame[64];
+  size_t size = 0;
+  ASSERT_EQ( crosstalk::serializeFrame( sent, frame, sizeof( frame ), size ),
+             crosstalk::WriteResult::Success );
+  // A count that passed the CRC but exceeds the frame, e.g., due to a bug on the sender
+  uint8_t corrupt[64];
+  std::copy( frame, frame + size, corrupt );
+  const size_t count_offset = 6 + 4 + 2 + 4;
+  corrupt[count_offset] = 0xFF;
+  corrupt[count_offset + 1] = 0xFF;
+  const uint16_t crc = crosstalk::util::compute_crc16( corrupt, size - 2 );
+  corrupt[size - 2] = crc & 0xFF;
+  corrupt[size - 1] = crc >> 8;
+
+  ArenaObject obj{};
+  crosstalk::ReadResult corrupt_result = crosstalk::ReadResult::Success;
+  crosstalk::ReadResult valid_result = crosstalk::ReadResult::NoObjectAvailable;
+  const size_t allocations = countAllocations( [&] {
+    serial->write( corrupt, size );
+    serial->write( frame, size );
+    talker->processSerialData();
+    corrupt_result = talker->readObject( obj, arena );
+    arena.reset();
+    valid_result = talker->readObject( obj, arena );
+  } );
+  EXPECT_EQ( allocations, 0u );
+  EXPECT_NE( corrupt_result, crosstalk::ReadResult::Success );
+  EXPECT_LE( arena.used(), 16u );
+  ASSERT_EQ( valid_result, crosstalk::ReadResult::Success );
+  EXPECT_EQ( obj.number, 7u );
+  EXPECT_EQ( obj.name, "name" );
+  EXPECT_EQ( obj.values.size(), 4u );
+}
+
+TEST( Allocations, ArenaExhaustedDoesNotAllocate )
+{
+  LoopbackSerial *serial;
+  auto talker = esp32_lora_estop_ros::makeLoopbackTalker<Talker>( serial );
+  crosstalk::StaticArena<8> arena;
+  uint16_t values[8] = {};
+  const ArenaObject sent{ 1, "too long for the arena", crosstalk::Span<uint16_t>( values, 8 ) };
+  uint8_t frame[128];
+  size_t size = 0;
+  ASSERT_EQ( crosstalk::serializeFrame( sent, frame, sizeof( frame ), size ),
+             crosstalk::WriteResult::Success );
+  ArenaObject obj{};
+  crosstalk::ReadResult result = crosstalk::ReadResult::Success;
+  const size_t allocations = countAllocations( [&] {
+    serial->write( frame, size );
+    talker->processSerialData();
+    result = talker->readObject( obj, arena );
+  } );
+  EXPECT_EQ( allocations, 0u );
+  EXPECT_EQ( result, crosstalk::ReadResult::ArenaExhausted );
+}
+
+TEST( Allocations, ReceiverObjectDispatchDoesNotAllocate )
+{
+  // The hot path of the receiver_interface_node: dispatch into Latest, then handle the newest
+  LoopbackSerial *serial;
+  auto talker = esp32_lora_estop_ros::makeLoopbackTalker<Talker>( serial );
+  uint8_t frame[ReceiverToHostObjects::max_frame_size()];
+  size_t handled = 0;
+  const size_t allocations = countAllocations( [&] {
+    for ( int cycle = 0; cycle < 500; ++cycle ) {
+      size_t size = 0;
+      EStopState state{};
+      state.hard_estop_active = cycle % 2 == 0;
+      crosstalk::serializeFrame( state, frame, sizeof( frame ), size );
+      serial->write( frame, size );
+      crosstalk::serializeFrame( EStopReceiverStatus{}, frame, sizeof( frame ), size );
+      serial->write( frame, size );
+      crosstalk::serializeFrame( LogRecord{}, frame, sizeof( frame ), size );
+      serial->write( frame, size );
+      talker->processSerialData();
+      ReceiverToHostObjects::Latest latest;
+      while ( ReceiverToHostObjects::dispatch( *talker, latest ) ==
+              crosstalk::ReadResult::Success ) {
+      }
+      latest.dispatch( [&]( const auto & ) { ++handled; } );
+    }
+  } );
+  EXPECT_EQ( allocations, 0u );
+  EXPECT_EQ( handled, 3u * 500 );
+}
+
+TEST( Allocations, PropertyUpdateCycleDoesNotAllocate )
+{
+  // Sender and receiver endpoints of the three transports exchanging the E-Stop properties
+  LoopbackTransport senders[] = { LoopbackTransport( CommTransport::LORA, 150 ),
+                                  LoopbackTransport( CommTransport::BLE ),
+                                  LoopbackTransport( CommTransport::ESP_NOW ) };
+  LoopbackTransport receivers[] = { LoopbackTransport( CommTransport::LORA, 150 ),
+                                    LoopbackTransport( CommTransport::BLE ),
+                                    LoopbackTransport( CommTransport::ESP_NOW ) };
+  TransportInterface *transports[3];
+  for ( int i = 0; i < 3; ++i ) {
+    LoopbackTransport::connect( senders[i], receivers[i] );
+    transports[i] = &receivers[i];
+  }
+  // The radio callbacks hand received properties to the loop through a mailbox
+  struct ReceivedPacket {
+    unsigned long receive_time_ms = 0;
+    uint8_t id = 0;
+    PropertyValue data;
+  };
+  SPSCQueue<ReceivedPacket, 16> mailbox;
+  EStopSequencer estop_sequencer;
+  EStopSequencer soft_estop_sequencer;
+  EStopArbiter arbiter;
+  size_t changes = 0;
+  size_t mailbox_active = 0;
+  bool last_active = true;
+  const size_t allocations = countAllocations( [&] {
+    for ( unsigned long now = 0; now < 60000; ++now ) {
+      const bool active = ( now / 1000 ) % 2 == 1;
+      for ( auto &endpoint : senders ) endpoint.setTime( now );
+      for ( auto &endpoint : receivers ) endpoint.setTime( now );
+      if ( estop_sequencer.update( active, now ) ) {
+        const PropertyValue data =
+            encodeEStopProperty( active, estop_sequencer.getSequence(), now );
+        for ( auto &sender : senders ) sender.setProperty( COMM_PROPERTY_ID_ESTOP, data );
+        mailbox.push( { now, COMM_PROPERTY_ID_ESTOP, data } );
+      }
+      if ( soft_estop_sequencer.update( false, now ) ) {
+        const PropertyValue data =
+            encodeSoftEStopProperty( false, soft_estop_sequencer.getSequence() );
+        for ( auto &sender : senders ) sender.setProperty( COMM_PROPERTY_ID_SOFT_ESTOP, data );
+      }
+      ReceivedPacket packet;
+      while ( mailbox.pop( packet ) ) {
+        PropertyValue value;
+        value.assign( packet.data.data(), packet.data.size() );
+        mailbox_active += readEStopState( value );
+      }
+      arbiter.update( transports, 3, now );
+      PropertyValue newest;
+      unsigned long age_ms;
+      readNewestProperty( transports, 3, COMM_PROPERTY_ID_ESTOP, newest, age_ms );
+      if ( arbiter.isEStopActive() != last_active ) {
+        last_active = arbiter.isEStopActive();
+        ++changes;
+      }
+    }
+  } );
+  EXPECT_EQ( allocations, 0u );
+  // The state toggles every second, the receiver follows
+  EXPECT_GE( changes, 59u );
+  EXPECT_FALSE( arbiter.isSoftEStopActive() );
+  EXPECT_GT( mailbox_active, 0u );
+  EXPECT_GT( arbiter.getStatistics( CommTransport::ESP_NOW ).received, 1000u );
+}
@@ -0,0 +1,112 @@
+// Checks that the CRC16 backends of crosstalk are bit-exact.
+// Built once with CROSSTALK_CRC16_SLICE_BY_8, which provides the tables for the table and all
+// sliced variants, and once with CROSSTALK_CRC16_ESP_ROM against the host stub in esp_rom_stub.
+
+#include <crosstalk.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace crosstalk::util;
+
+namespace
+{
+struct KnownVector {
+  std::vector<uint8_t> data;
+  uint16_t crc;
+};
+
+std::vector<uint8_t> bytes( const std::string &text ) { return { text.begin(), text.end() }; }
+
+std::vector<KnownVector> knownVectors()
+{
+  std::vector<uint8_t> counting( 256 );
+  for ( size_t i = 0; i < counting.size(); ++i ) counting[i] = static_cast<uint8_t>( i );
+  return {
+      { {}, 0xFFFF },
+      { bytes( "A" ), 0xB915 },
+      // Check value of CRC-16/CCITT-FALSE
+      { bytes( "123456789" ), 0x29B1 },
+      { std::vector<uint8_t>( 256, 0 ), 0x41E8 },
+      { counting, 0x3FBD },
+      // Header and payload of a frame with id 2 and the 3 byte payload 01 00 05
+      { { 0x02, 0x42, 0x02, 0x00, 0x03, 0x00, 0x01, 0x00, 0x05 }, 0x4EC7 },
+  };
+}
+
+//! Every backend available in this translation unit, the reference first.
+std::vector<std::pair<std::string, uint16_t ( * )( uint16_t, const uint8_t *, size_t )>> backends()
+{
+  return {
+      { "bitwise", &crc16::update_bitwise },
+#if CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_SLICE_BY_8
+      { "table", &crc16::update_table },
+      { "slice_by_4", &crc16::update_sliced<4> },
+      { "slice_by_8", &crc16::update_sliced<8> },
+#elif CROSSTALK_CRC16_BACKEND == CROSSTALK_CRC16_ESP_ROM
+      { "esp_rom", &crc16::update_esp_rom },
+#endif
+      { "update", &crc16::update },
+  };
+}
+} // namespace
+
+TEST( Crc16, KnownVectors )
+{
+  for ( const auto &[name, update] : backends() ) {
+    for ( const auto &vector : knownVectors() ) {
+      EXPECT_EQ( update( crc16::initial_value, vector.data.data(), vector.data.size() ),
+                 vector.crc )
+          << name << " with " << vector.data.size() << " bytes";
+    }
+  }
+  const std::vector<uint8_t> check = bytes( "123456789" );
+  EXPECT_EQ( compute_crc16( check.data(), check.size() ), 0x29B1 );
+}
+
+TEST( Crc16, RandomDataMatchesBitwise )
+{
+  std::mt19937 rng( 42 );
+  std::uniform_int_distribution<int> byte( 0, 255 );
+  std::vector<uint8_t> buffer( 4096 + 8 );
+  for ( auto &value : buffer ) value = static_cast<uint8_t>( byte( rng ) );
+  const auto all = backends();
+  for ( int i = 0; i < 2000; ++i ) {
+    // Random lengths and unaligned starts exercise the remainder handling of the sliced backends
+    const size_t length = std::uniform_int_distribution<size_t>( 0, i < 1000 ? 64 : 4096 )( rng );
+    const size_t offset = std::uniform_int_distribution<size_t>( 0, 7 )( rng );
+    const uint16_t initial = static_cast<uint16_t>( rng() );
+    const uint16_t expected = crc16::update_bitwise( initial, buffer.data() + offset, length );
+    for ( const auto &[name, update] : all ) {
+      ASSERT_EQ( update( initial, buffer.data() + offset, length ), expected )
+          << name << " with " << length << " bytes at offset " << offset;
+    }
+  }
+}
+
+TEST( Crc16, ChunkedUpdateMatchesSinglePass )
+{
+  std::mt19937 rng( 7 );
+  std::vector<uint8_t> buffer( 1024 );
+  for ( auto &value : buffer ) value = static_cast<uint8_t>( rng() );
+  const uint16_t expected =
+      crc16::update_bitwise( crc16::initial_value, buffer.data(), buffer.size() );
+  for ( const auto &[name, update] : backends() ) {
+    for ( int i = 0; i < 100; ++i ) {
+      // Frames wrapping around the ring buffer are checked in two or more chunks
+      uint16_t crc = crc16::initial_value;
+      size_t position = 0;
+      while ( position < buffer.size() ) {
+        const size_t chunk = std::min<size_t>(
+            std::uniform_int_distribution<size_t>( 0, 100 )( rng ), buffer.size() - position );
+        crc = update( crc, buffer.data() + position, chunk );
+        position += chunk;
+      }
+      ASSERT_EQ( crc, expected ) << name;
+    }
+  }
+}
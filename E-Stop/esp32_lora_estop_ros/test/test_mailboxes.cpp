@@ -0,0 +1,187 @@
+// Stress tests of the lock-free structures shared between the radio callbacks and the update loop
+// of the firmware: the SPSCQueue mailboxes and the PeerTable of the ESP-NOW connections.
+
+#include <comm_transport.h>
+#include <peer_table.h>
+#include <spsc_queue.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+//! Like the received packets of the transports. The data is derived from the index to detect torn
+//! copies.
+struct Packet {
+  uint32_t index = 0;
+  PropertyValue data;
+};
+
+PropertyValue makeData( uint32_t index )
+{
+  return { static_cast<uint8_t>( index ),       static_cast<uint8_t>( index >> 8 ),
+           static_cast<uint8_t>( index >> 16 ), static_cast<uint8_t>( index >> 24 ),
+           static_cast<uint8_t>( ~index ),      static_cast<uint8_t>( index * 7 ) };
+}
+
+struct Peer {
+  std::array<uint8_t, 6> mac;
+};
+
+std::array<uint8_t, 6> makeMac( uint32_t index )
+{
+  // Same vendor prefix for all peers like ESP32 boards of one batch
+  return { 0x24,
+           0x6F,
+           0x28,
+           static_cast<uint8_t>( index >> 16 ),
+           static_cast<uint8_t>( index >> 8 ),
+           static_cast<uint8_t>( index ) };
+}
+} // namespace
+
+TEST( SPSCQueue, DropsAndCountsWhenFull )
+{
+  SPSCQueue<Packet, 4> queue;
+  for ( uint32_t i = 0; i < 6; ++i ) EXPECT_EQ( queue.push( { i, makeData( i ) } ), i < 4 );
+  EXPECT_EQ( queue.takeDropped(), 2u );
+  EXPECT_EQ( queue.takeDropped(), 0u );
+  Packet packet;
+  for ( uint32_t i = 0; i < 4; ++i ) {
+    ASSERT_TRUE( queue.pop( packet ) );
+    EXPECT_EQ( packet.index, i );
+  }
+  EXPECT_FALSE( queue.pop( packet ) );
+}
+
+TEST( SPSCQueue, ConcurrentProducerAndConsumer )
+{
+  constexpr uint32_t packet_count = 1000000;
+  SPSCQueue<Packet, 16> queue;
+  std::atomic<bool> producer_done{ false };
+  uint32_t pushed = 0;
+  std::thread producer( [&] {
+    // Like a radio callback, the producer never waits and drops packets if the queue is full
+    for ( uint32_t i = 0; i < packet_count; ++i ) {
+      if ( queue.push( { i, makeData( i ) } ) )
+        ++pushed;
+    }
+    producer_done.store( true, std::memory_order_release );
+  } );
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t out_of_order = 0;
+  uint32_t dropped = 0;
+  int64_t last_index = -1;
+  const auto drain = [&] {
+    Packet packet;
+    while ( queue.pop( packet ) ) {
+      ++received;
+      torn += packet.data != makeData( packet.index );
+      out_of_order += static_cast<int64_t>( packet.index ) <= last_index;
+      last_index = packet.index;
+    }
+    dropped += queue.takeDropped();
+  };
+  while ( !producer_done.load( std::memory_order_acquire ) ) {
+    drain();
+    std::this_thread::yield();
+  }
+  producer.join();
+  drain();
+
+  EXPECT_EQ( torn, 0u );
+  EXPECT_EQ( out_of_order, 0u );
+  EXPECT_EQ( received, pushed );
+  EXPECT_EQ( received + dropped, packet_count );
+}
+
+TEST( PeerTable, InsertFindRemove )
+{
+  PeerTable<Peer, 8> table;
+  std::vector<Peer> peers;
+  for ( uint32_t i = 0; i < 5; ++i ) peers.push_back( { makeMac( i ) } );
+  for ( size_t i = 0; i < 4; ++i ) EXPECT_TRUE( table.insert( peers[i].mac.data(), &peers[i] ) );
+  EXPECT_FALSE( table.insert( peers[4].mac.data(), &peers[4] ) )
+      << "Only half of the slots are used";
+  EXPECT_FALSE( table.insert( peers[0].mac.data(), &peers[0] ) ) << "Duplicate address";
+  for ( size_t i = 0; i < 4; ++i ) EXPECT_EQ( table.find( peers[i].mac.data() ), &peers[i] );
+  EXPECT_EQ( table.find( peers[4].mac.data() ), nullptr );
+  EXPECT_TRUE( table.remove( peers[1].mac.data() ) );
+  EXPECT_FALSE( table.remove( peers[1].mac.data() ) );
+  EXPECT_EQ( table.find( peers[1].mac.data() ), nullptr );
+  // Probes continue past the tombstone
+  for ( size_t i : { 0, 2, 3 } ) EXPECT_EQ( table.find( peers[i].mac.data() ), &peers[i] );
+  EXPECT_TRUE( table.insert( peers[4].mac.data(), &peers[4] ) );
+  EXPECT_EQ( table.find( peers[4].mac.data() ), &peers[4] );
+  EXPECT_EQ( table.size(), 4u );
+}
+
+TEST( PeerTable, ConcurrentLookupsWhilePeersChange )
+{
+  // The loop adds and removes peers while the WiFi callbacks look up the senders of packets
+  constexpr int reader_count = 2;
+  constexpr uint32_t stable_count = 4;
+  constexpr uint32_t transient_count = 32;
+  PeerTable<Peer, 32> table;
+  std::vector<Peer> stable;
+  std::vector<Peer> transient;
+  for ( uint32_t i = 0; i < stable_count; ++i ) stable.push_back( { makeMac( i ) } );
+  for ( uint32_t i = 0; i < transient_count; ++i ) transient.push_back( { makeMac( 1000 + i ) } );
+  for ( auto &peer : stable ) ASSERT_TRUE( table.insert( peer.mac.data(), &peer ) );
+
+  std::atomic<bool> done{ false };
+  std::atomic<uint32_t> stable_missing{ 0 };
+  std::atomic<uint32_t> wrong_peer{ 0 };
+  std::atomic<uint32_t> foreign_found{ 0 };
+  std::atomic<uint32_t> transient_found{ 0 };
+  std::vector<std::thread> readers;
+  for ( int r = 0; r < reader_count; ++r ) {
+    readers.emplace_back( [&, r] {
+      uint32_t foreign = 100000 * ( r + 1 );
+      while ( !done.load( std::memory_order_acquire ) ) {
+        for ( const auto &peer : stable ) {
+          const Peer *found = table.find( peer.mac.data() );
+          stable_missing += found == nullptr;
+          wrong_peer += found != nullptr && found != &peer;
+        }
+        for ( const auto &peer : transient ) {
+          // Peers may come and go, but a lookup must never return another peer
+          const Peer *found = table.find( peer.mac.data() );
+          transient_found += found != nullptr;
+          wrong_peer += found != nullptr && found->mac != peer.mac;
+        }
+        // Beacons of foreign devices in range
+        const auto mac = makeMac( foreign++ );
+        foreign_found += table.find( mac.data() ) != nullptr;
+      }
+    } );
+  }
+  // Never more than MAX_PEERS, so every insert has to succeed
+  const uint32_t active = decltype( table )::MAX_PEERS - stable_count;
+  uint32_t failed_inserts = 0;
+  for ( int round = 0; round < 20000; ++round ) {
+    for ( uint32_t i = 0; i < active; ++i ) {
+      Peer &peer = transient[( round + i ) % transient_count];
+      failed_inserts += !table.insert( peer.mac.data(), &peer );
+    }
+    for ( uint32_t i = 0; i < active; ++i ) {
+      Peer &peer = transient[( round + i ) % transient_count];
+      failed_inserts += !table.remove( peer.mac.data() );
+    }
+  }
+  done.store( true, std::memory_order_release );
+  for ( auto &reader : readers ) reader.join();
+
+  EXPECT_EQ( failed_inserts, 0u );
+  EXPECT_EQ( stable_missing.load(), 0u );
+  EXPECT_EQ( wrong_peer.load(), 0u );
+  EXPECT_EQ( foreign_found.load(), 0u );
+  EXPECT_EQ( table.size(), stable_count );
+  RecordProperty( "transient_found", std::to_string( transient_found.load() ) );
+}
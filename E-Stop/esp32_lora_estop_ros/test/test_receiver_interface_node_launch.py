@@ -0,0 +1,171 @@
+# Launches the receiver_interface_node using its launch file on the slave side of a pseudo terminal.
+# The test acts as the receiver firmware on the master side and checks the published E-Stop state
+# and the commands sent to the receiver.
+
+import itertools
+import os
+import select
+import struct
+import time
+import unittest
+
+import launch
+import launch_testing.actions
+import launch_testing.asserts
+import pytest
+import rclpy
+from esp32_lora_estop_interface.srv import SetEnabled
+from launch.actions import IncludeLaunchDescription
+from launch.launch_description_sources import PythonLaunchDescriptionSource
+from rclpy.qos import DurabilityPolicy, QoSProfile, ReliabilityPolicy
+from std_msgs.msg import Bool
+
+# Both ends stay open for the lifetime of the test, the node opens the slave by its path
+MASTER_FD, SLAVE_FD = os.openpty()
+os.set_blocking(MASTER_FD, False)
+
+ESTOP_STATE_ID = 0x02
+RECEIVER_STATUS_ID = 0x03
+SET_ENABLED_COMMAND_ID = 0x03
+SEQUENCE = itertools.count(1)
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE as computed by crosstalk."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def frame(object_id, payload):
+    header = struct.pack("<BBHH", 0x02, 0x42, object_id, len(payload))
+    return header + payload + struct.pack("<H", crc16(header + payload))
+
+
+def estop_state(hard_estop_active, sequence):
+    # enabled, hard, soft, deadman active and triggered, then the trace and the send time
+    payload = struct.pack("<8B3I", 1, hard_estop_active, 0, 0, 0, sequence & 0xFF, 0, 0, 0, 0, 0)
+    return frame(ESTOP_STATE_ID, payload)
+
+
+def receiver_status():
+    # Two CommStatus objects, all links disconnected
+    return frame(RECEIVER_STATUS_ID, bytes(92))
+
+
+@pytest.mark.launch_test
+def generate_test_description():
+    launch_file = os.path.join(
+        os.path.dirname(__file__), "..", "launch", "receiver_interface_node.launch.py"
+    )
+    return launch.LaunchDescription(
+        [
+            IncludeLaunchDescription(
+                PythonLaunchDescriptionSource(launch_file),
+                launch_arguments={"serial_port": os.ttyname(SLAVE_FD)}.items(),
+            ),
+            launch_testing.actions.ReadyToTest(),
+        ]
+    )
+
+
+class TestReceiverInterfaceNode(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        rclpy.init()
+
+    @classmethod
+    def tearDownClass(cls):
+        rclpy.shutdown()
+
+    def setUp(self):
+        self.node = rclpy.create_node("test_receiver_interface_node")
+        self.hard_estop = []
+        # Keeps every transition published within one batch until the test spins
+        qos = QoSProfile(
+            depth=10,
+            reliability=ReliabilityPolicy.RELIABLE,
+            durability=DurabilityPolicy.TRANSIENT_LOCAL,
+        )
+        self.node.create_subscription(
+            Bool, "/remote_estop/hard_estop", lambda msg: self.hard_estop.append(msg.data), qos
+        )
+        self.set_enabled = self.node.create_client(SetEnabled, "/remote_estop/set_enabled")
+        # The service is created after the serial port was opened and the node was activated
+        self.assertTrue(self.set_enabled.wait_for_service(timeout_sec=20.0))
+
+    def tearDown(self):
+        self.node.destroy_node()
+
+    def spin_until(self, predicate, timeout=5.0):
+        end = time.monotonic() + timeout
+        while not predicate() and time.monotonic() < end:
+            rclpy.spin_once(self.node, timeout_sec=0.05)
+        return predicate()
+
+    def send_state(self, hard_estop_active, status_frames=0):
+        data = b"".join(receiver_status() for _ in range(status_frames))
+        os.write(MASTER_FD, data + estop_state(hard_estop_active, next(SEQUENCE)))
+
+    def send_states(self, hard_estop_active):
+        # A single write, hence, the node reads all states in the same batch
+        data = b"".join(estop_state(active, next(SEQUENCE)) for active in hard_estop_active)
+        os.write(MASTER_FD, data)
+
+    def read_sent(self, timeout):
+        data = b""
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            if select.select([MASTER_FD], [], [], 0.05)[0]:
+                data += os.read(MASTER_FD, 4096)
+        return data
+
+    def test_node_is_active(self):
+        # Publishes the latched E-Stop state once activated
+        self.assertTrue(self.spin_until(lambda: len(self.hard_estop) > 0))
+
+    def test_forwards_estop_state(self):
+        for active in [False, True, False, True]:
+            self.send_state(active)
+            self.assertTrue(
+                self.spin_until(lambda: self.hard_estop and self.hard_estop[-1] == active)
+            )
+
+    def test_latest_state_after_status_burst(self):
+        # A burst of status frames must not delay the E-Stop state queued behind them
+        self.send_state(False)
+        self.assertTrue(self.spin_until(lambda: self.hard_estop and not self.hard_estop[-1]))
+        self.send_state(True, status_frames=30)
+        self.assertTrue(self.spin_until(lambda: self.hard_estop[-1], timeout=1.0))
+
+    def test_publishes_activation_released_in_same_batch(self):
+        self.send_state(False)
+        self.assertTrue(self.spin_until(lambda: self.hard_estop and not self.hard_estop[-1]))
+        self.hard_estop.clear()
+        self.send_states([True, False])
+        self.assertTrue(self.spin_until(lambda: len(self.hard_estop) >= 2))
+        self.assertEqual(self.hard_estop, [True, False])
+
+    def test_logs_receiver_text(self, proc_output):
+        # Boot messages before a frame are logged line by line, the frame is still dispatched
+        os.write(MASTER_FD, b"rst:0x1 (POWERON_RESET)\r\n" + estop_state(True, next(SEQUENCE)))
+        proc_output.assertWaitFor("rst:0x1 (POWERON_RESET)", timeout=5)
+        self.assertTrue(self.spin_until(lambda: self.hard_estop and self.hard_estop[-1]))
+
+    def test_sends_set_enabled_command(self):
+        for enabled in [False, True]:
+            future = self.set_enabled.call_async(SetEnabled.Request(enabled=enabled))
+            self.assertTrue(self.spin_until(future.done))
+        self.assertEqual(
+            self.read_sent(timeout=1.0),
+            frame(SET_ENABLED_COMMAND_ID, b"\x00") + frame(SET_ENABLED_COMMAND_ID, b"\x01"),
+        )
+
+
+@launch_testing.post_shutdown_test()
+class TestReceiverInterfaceNodeShutdown(unittest.TestCase):
+    def test_exit_code(self, proc_info):
+        launch_testing.asserts.assertExitCodes(proc_info)
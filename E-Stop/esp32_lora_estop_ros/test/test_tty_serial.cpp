@@ -0,0 +1,271 @@
+// Round trips frames through TtySerial on the slave side of a pseudo terminal. The test writes and
+// reads the master side like the receiver firmware on the other end of the USB cable.
+
+#include <crosstalk.hpp>
+#include <host_comm.h>
+
+#include "crosstalk_mirrored_ring_storage.hpp"
+#include "crosstalk_tty_serial.hpp"
+#include "loopback_serial.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+//! The master side of a pseudo terminal. The slave is the device opened by TtySerial.
+class PseudoTerminal
+{
+public:
+  PseudoTerminal()
+  {
+    fd_ = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC );
+    if ( fd_ == -1 || grantpt( fd_ ) != 0 || unlockpt( fd_ ) != 0 )
+      throw std::runtime_error( std::string( "Failed to open pseudo terminal: " ) +
+                                std::strerror( errno ) );
+    device_ = ptsname( fd_ );
+  }
+
+  ~PseudoTerminal() { ::close( fd_ ); }
+
+  PseudoTerminal( const PseudoTerminal & ) = delete;
+  PseudoTerminal &operator=( const PseudoTerminal & ) = delete;
+
+  const std::string &device() const { return device_; }
+
+  //! Writes as much as the pseudo terminal accepts and returns the number of bytes written.
+  size_t write( const uint8_t *data, size_t length )
+  {
+    const ssize_t result = ::write( fd_, data, length );
+    return result > 0 ? static_cast<size_t>( result ) : 0;
+  }
+
+  //! Reads everything that arrives within the timeout.
+  std::vector<uint8_t> read( int timeout_ms )
+  {
+    std::vector<uint8_t> data;
+    uint8_t buffer[256];
+    pollfd pfd = { fd_, POLLIN, 0 };
+    while ( ::poll( &pfd, 1, timeout_ms ) > 0 ) {
+      const ssize_t result = ::read( fd_, buffer, sizeof( buffer ) );
+      if ( result <= 0 )
+        break;
+      data.insert( data.end(), buffer, buffer + result );
+    }
+    return data;
+  }
+
+private:
+  int fd_ = -1;
+  std::string device_;
+};
+
+template<typename T>
+std::vector<uint8_t> makeFrame( const T &obj )
+{
+  uint8_t frame[ReceiverToHostObjects::max_frame_size()];
+  size_t size = 0;
+  EXPECT_EQ( crosstalk::serializeFrame( obj, frame, sizeof( frame ), size ),
+             crosstalk::WriteResult::Success );
+  return { frame, frame + size };
+}
+
+//! Values that contain the bytes a tty in canonical mode would translate or interpret, e.g., CR,
+//! LF, XON, XOFF, the interrupt character and DEL.
+EStopState makeState( uint8_t sequence )
+{
+  EStopState state{};
+  state.hard_estop_active = sequence % 2 == 1;
+  state.trace.sequence = sequence;
+  state.trace.sender_time_ms = 0x0D0A1113;
+  state.trace.receive_time_ms = 0x7F03041A;
+  state.send_time_ms = 0x00FF0D0A + sequence;
+  return state;
+}
+} // namespace
+
+template<typename Talker>
+class TtySerialTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    auto serial = std::make_unique<crosstalk::TtySerial>( pty_.device(), 921600 );
+    serial_ = serial.get();
+    talker_ = std::make_unique<Talker>( std::move( serial ) );
+  }
+
+  //! Waits for data like the reader thread of the receiver_interface_node and dispatches it.
+  template<typename Handler>
+  void receive( Handler &&handler, int timeout_ms = 100 )
+  {
+    pollfd pfd = { serial_->fd(), POLLIN, 0 };
+    while ( ::poll( &pfd, 1, timeout_ms ) > 0 ) {
+      talker_->processSerialData();
+      while ( true ) {
+        // Debug text before a frame has to be read before the frame can be dispatched
+        if ( const int available = talker_->available(); available > 0 ) {
+          std::vector<uint8_t> buffer( available );
+          talker_->read( buffer.data(), buffer.size() );
+          text_.append( buffer.begin(), buffer.end() );
+        }
+        const crosstalk::ReadResult result = ReceiverToHostObjects::dispatch( *talker_, handler );
+        if ( result == crosstalk::ReadResult::NoObjectAvailable ||
+             result == crosstalk::ReadResult::NotEnoughData )
+          break;
+        EXPECT_EQ( result, crosstalk::ReadResult::Success );
+      }
+      timeout_ms = 0;
+    }
+  }
+
+  PseudoTerminal pty_;
+  crosstalk::TtySerial *serial_ = nullptr;
+  std::unique_ptr<Talker> talker_;
+  std::string text_;
+};
+
+using Talkers =
+    ::testing::Types<crosstalk::CrossTalker<4096, 128>,
+                     crosstalk::CrossTalker<4096, 128, crosstalk::MirroredRingStorage>>;
+TYPED_TEST_SUITE( TtySerialTest, Talkers );
+
+TYPED_TEST( TtySerialTest, ReceivesFramesInChunks )
+{
+  // Boot messages of the firmware followed by objects, split at arbitrary positions
+  const std::string text = "ets Jun  8 2016 00:22:57\r\nrst:0x1 (POWERON_RESET)\r\n";
+  std::vector<uint8_t> stream( text.begin(), text.end() );
+  for ( uint8_t i = 1; i <= 20; ++i ) {
+    const auto frame = makeFrame( makeState( i ) );
+    stream.insert( stream.end(), frame.begin(), frame.end() );
+    if ( i % 5 == 0 ) {
+      const auto status = makeFrame( EStopReceiverStatus{} );
+      stream.insert( stream.end(), status.begin(), status.end() );
+      LogRecord record;
+      record.args = { 0x0A0D, -1 };
+      const auto log = makeFrame( record );
+      stream.insert( stream.end(), log.begin(), log.end() );
+    }
+  }
+  std::vector<EStopState> states;
+  size_t status_count = 0;
+  size_t log_count = 0;
+  const auto handler = crosstalk::overloaded{
+      [&]( const EStopState &state ) { states.push_back( state ); },
+      [&]( const EStopReceiverStatus & ) { ++status_count; },
+      [&]( const LogRecord &record ) {
+        ++log_count;
+        EXPECT_EQ( record.args[0], 0x0A0D );
+        EXPECT_EQ( record.args[1], -1 );
+      } };
+  const size_t chunk_sizes[] = { 1, 7, 3, 64, 13, 2, 31 };
+  for ( size_t offset = 0, i = 0; offset < stream.size(); ++i ) {
+    const size_t chunk =
+        std::min( chunk_sizes[i % std::size( chunk_sizes )], stream.size() - offset );
+    ASSERT_EQ( this->pty_.write( stream.data() + offset, chunk ), chunk );
+    offset += chunk;
+    this->receive( handler, 10 );
+  }
+  this->receive( handler );
+
+  ASSERT_EQ( states.size(), 20u );
+  for ( uint8_t i = 1; i <= 20; ++i ) {
+    const EStopState expected = makeState( i );
+    const EStopState &state = states[i - 1];
+    EXPECT_EQ( state.trace.sequence, i );
+    EXPECT_EQ( state.hard_estop_active, expected.hard_estop_active );
+    EXPECT_EQ( state.trace.sender_time_ms, expected.trace.sender_time_ms );
+    EXPECT_EQ( state.trace.receive_time_ms, expected.trace.receive_time_ms );
+    EXPECT_EQ( state.send_time_ms, expected.send_time_ms );
+  }
+  EXPECT_EQ( status_count, 4u );
+  EXPECT_EQ( log_count, 4u );
+  EXPECT_EQ( this->text_, text );
+}
+
+TYPED_TEST( TtySerialTest, ReceivesLongStreamsInOrder )
+{
+  // Wraps the ring buffer many times. Written in chunks that fit into the buffer of the talker,
+  // as processSerialData overwrites the oldest data if more is pending, e.g., after a stall.
+  std::vector<uint8_t> stream;
+  constexpr int frame_count = 5000;
+  for ( int i = 0; i < frame_count; ++i ) {
+    const auto frame = makeFrame( makeState( static_cast<uint8_t>( i ) ) );
+    stream.insert( stream.end(), frame.begin(), frame.end() );
+  }
+  int received = 0;
+  int out_of_order = 0;
+  uint8_t next_sequence = 0;
+  const auto handler = crosstalk::overloaded{
+      [&]( const EStopState &state ) {
+        ++received;
+        out_of_order += state.trace.sequence != next_sequence;
+        next_sequence = state.trace.sequence + 1;
+      },
+      []( const auto & ) {} };
+  for ( size_t offset = 0; offset < stream.size(); ) {
+    const size_t chunk = std::min<size_t>( 1000, stream.size() - offset );
+    const size_t written = this->pty_.write( stream.data() + offset, chunk );
+    ASSERT_GT( written, 0u );
+    offset += written;
+    this->receive( handler, 10 );
+  }
+  this->receive( handler );
+  EXPECT_EQ( received, frame_count );
+  EXPECT_EQ( out_of_order, 0 );
+  EXPECT_EQ( this->text_, "" );
+}
+
+TYPED_TEST( TtySerialTest, SendsFrames )
+{
+  for ( bool enabled : { true, false, true } ) {
+    SetEnabledCommand command;
+    command.enabled = enabled;
+    ASSERT_EQ( this->talker_->sendObject( command ), crosstalk::WriteResult::Success );
+  }
+  // Decode the bytes that arrived on the master side like the firmware
+  const std::vector<uint8_t> data = this->pty_.read( 100 );
+  esp32_lora_estop_ros::LoopbackSerial *loopback;
+  auto receiver = esp32_lora_estop_ros::makeLoopbackTalker<crosstalk::CrossTalker<1024, 64>>(
+      loopback );
+  loopback->write( data.data(), data.size() );
+  receiver->processSerialData();
+  std::vector<bool> commands;
+  while ( HostToReceiverObjects::dispatch( *receiver, [&]( const SetEnabledCommand &command ) {
+            commands.push_back( command.enabled );
+          } ) == crosstalk::ReadResult::Success ) {
+  }
+  EXPECT_EQ( commands, ( std::vector<bool>{ true, false, true } ) );
+  EXPECT_EQ( receiver->available(), 0 ) << "The output must not be translated, e.g., LF to CRLF";
+}
+
+TYPED_TEST( TtySerialTest, ReportsDrainedAfterShortRead )
+{
+  EXPECT_GT( this->serial_->available(), 0 ) << "Unknown until a read came back short";
+  uint8_t buffer[16];
+  EXPECT_EQ( this->serial_->read( buffer, sizeof( buffer ) ), 0 );
+  EXPECT_EQ( this->serial_->available(), 0 );
+  // Probes the port again afterwards
+  EXPECT_GT( this->serial_->available(), 0 );
+  const uint8_t data[4] = { 1, 2, 3, 4 };
+  ASSERT_EQ( this->pty_.write( data, sizeof( data ) ), sizeof( data ) );
+  pollfd pfd = { this->serial_->fd(), POLLIN, 0 };
+  ASSERT_EQ( ::poll( &pfd, 1, 1000 ), 1 );
+  EXPECT_EQ( this->serial_->read( buffer, sizeof( buffer ) ), 4 );
+  EXPECT_EQ( this->serial_->available(), 0 );
+}
+
+TEST( TtySerial, ThrowsOnInvalidDeviceOrBaudRate )
+{
+  EXPECT_THROW( crosstalk::TtySerial( "/dev/does_not_exist" ), std::runtime_error );
+  PseudoTerminal pty;
+  EXPECT_THROW( crosstalk::TtySerial( pty.device(), 12345 ), std::runtime_error );
+  EXPECT_NO_THROW( crosstalk::TtySerial( pty.device(), 9600 ) );
+}
@@ -0,0 +1,246 @@
+// Stress test of the multi-producer single-consumer crosstalk::TxQueue.
+// Several producers push frames concurrently while one consumer drains them. Every drained frame
+// has to be complete with a valid CRC and the frames of each producer have to arrive in order.
+// Also checks that PriorityTxQueue::flush keeps the reserve of the TX buffer for urgent frames.
+
+#include <crosstalk.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StressObject {
+  uint8_t producer;
+  uint32_t index;
+  std::array<uint8_t, 32> payload;
+};
+
+REFL_AUTO( type( StressObject, crosstalk::id( 0x30 ) ), field( producer ), field( index ),
+           field( payload ) )
+
+struct LargeObject {
+  std::string text;
+};
+
+REFL_AUTO( type( LargeObject, crosstalk::id( 0x31 ) ), field( text ) )
+
+struct UrgentObject {
+  uint32_t index;
+};
+
+REFL_AUTO( type( UrgentObject, crosstalk::id( 0x32 ), crosstalk::priority( 1 ) ), field( index ) )
+
+namespace
+{
+using Queue = crosstalk::TxQueue<64, 16>;
+
+StressObject makeObject( uint8_t producer, uint32_t index )
+{
+  StressObject obj{ producer, index, {} };
+  for ( size_t i = 0; i < obj.payload.size(); ++i )
+    obj.payload[i] = static_cast<uint8_t>( producer * 31 + index * 7 + i );
+  return obj;
+}
+
+//! Checks the frame format and CRC and decodes the object. Returns false if the frame is corrupt.
+bool decodeFrame( const uint8_t *frame, size_t size, StressObject &obj )
+{
+  if ( size < 8 || frame[0] != 0x02 || frame[1] != 0x42 )
+    return false;
+  const int16_t id = static_cast<int16_t>( frame[2] | frame[3] << 8 );
+  const size_t payload_size = frame[4] | frame[5] << 8;
+  if ( id != crosstalk::object_id<StressObject>() || payload_size + 8 != size )
+    return false;
+  const uint16_t crc = frame[6 + payload_size] | frame[7 + payload_size] << 8;
+  if ( crosstalk::util::compute_crc16( frame, 6 + payload_size ) != crc )
+    return false;
+  crosstalk::util::SegmentedReader reader( frame + 6, payload_size );
+  return crosstalk::util::deserialize( reader, obj ) == payload_size;
+}
+
+struct ConsumerResult {
+  std::vector<uint32_t> received;    //!< Number of frames received per producer.
+  std::vector<uint32_t> next_index;  //!< Smallest index the next frame of the producer may have.
+  size_t corrupt = 0;
+  size_t out_of_order = 0;
+};
+
+/*!
+ * Drains the queue until all producers are done and the queue is empty.
+ * @param consecutive Whether the indices of a producer have to be consecutive or only increasing.
+ */
+void consume( Queue &queue, const std::atomic<int> &running_producers, bool consecutive,
+              ConsumerResult &result )
+{
+  const auto handle = [&]( const uint8_t *frame, size_t size ) {
+    StressObject obj;
+    if ( !decodeFrame( frame, size, obj ) || obj.producer >= result.received.size() ||
+         obj.payload != makeObject( obj.producer, obj.index ).payload ) {
+      ++result.corrupt;
+      return;
+    }
+    uint32_t &next = result.next_index[obj.producer];
+    if ( consecutive ? obj.index != next : obj.index < next )
+      ++result.out_of_order;
+    next = obj.index + 1;
+    ++result.received[obj.producer];
+  };
+  while ( running_producers.load( std::memory_order_acquire ) > 0 ) {
+    if ( queue.drain( handle ) == 0 )
+      std::this_thread::yield();
+  }
+  queue.drain( handle );
+}
+
+//! A serial port with a TX buffer that is only emptied by the test.
+struct TxBufferTalker {
+  int capacity = 0;
+  std::vector<int16_t> ids;
+  std::vector<size_t> sizes;
+
+  int availableForWrite() const
+  {
+    int used = 0;
+    for ( size_t size : sizes ) used += static_cast<int>( size );
+    return capacity - used;
+  }
+
+  void sendFrame( const uint8_t *frame, size_t size )
+  {
+    ids.push_back( static_cast<int16_t>( frame[2] | frame[3] << 8 ) );
+    sizes.push_back( size );
+  }
+};
+} // namespace
+
+TEST( TxQueue, DrainsInOrderAndReportsFull )
+{
+  Queue queue;
+  EXPECT_TRUE( queue.empty() );
+  for ( uint32_t i = 0; i < 16; ++i )
+    ASSERT_EQ( queue.push( makeObject( 0, i ) ), crosstalk::WriteResult::Success );
+  EXPECT_EQ( queue.push( makeObject( 0, 16 ) ), crosstalk::WriteResult::QueueFull );
+  uint32_t index = 0;
+  const size_t count = queue.drain( [&]( const uint8_t *frame, size_t size ) {
+    StressObject obj;
+    ASSERT_TRUE( decodeFrame( frame, size, obj ) );
+    EXPECT_EQ( obj.index, index++ );
+  } );
+  EXPECT_EQ( count, 16u );
+  EXPECT_TRUE( queue.empty() );
+}
+
+TEST( TxQueue, SkipsFramesThatDoNotFit )
+{
+  Queue queue;
+  EXPECT_EQ( queue.push( LargeObject{ std::string( 100, 'x' ) } ),
+             crosstalk::WriteResult::ObjectTooLarge );
+  ASSERT_EQ( queue.push( makeObject( 0, 1 ) ), crosstalk::WriteResult::Success );
+  size_t count = 0;
+  queue.drain( [&]( const uint8_t *frame, size_t size ) {
+    StressObject obj;
+    EXPECT_TRUE( decodeFrame( frame, size, obj ) );
+    EXPECT_EQ( obj.index, 1u );
+    ++count;
+  } );
+  EXPECT_EQ( count, 1u );
+}
+
+TEST( TxQueue, ConcurrentProducersRetrying )
+{
+  constexpr int producer_count = 4;
+  constexpr uint32_t frames_per_producer = 50000;
+  Queue queue;
+  std::atomic<int> running_producers{ producer_count };
+  std::atomic<size_t> queue_full{ 0 };
+  ConsumerResult result;
+  result.received.resize( producer_count );
+  result.next_index.resize( producer_count );
+  std::thread consumer( [&] { consume( queue, running_producers, true, result ); } );
+  std::vector<std::thread> producers;
+  for ( int p = 0; p < producer_count; ++p ) {
+    producers.emplace_back( [&, p] {
+      for ( uint32_t i = 0; i < frames_per_producer; ) {
+        if ( queue.push( makeObject( p, i ) ) == crosstalk::WriteResult::Success ) {
+          ++i;
+          continue;
+        }
+        queue_full.fetch_add( 1, std::memory_order_relaxed );
+        std::this_thread::yield();
+      }
+      running_producers.fetch_sub( 1, std::memory_order_release );
+    } );
+  }
+  for ( auto &producer : producers ) producer.join();
+  consumer.join();
+
+  EXPECT_EQ( result.corrupt, 0u );
+  EXPECT_EQ( result.out_of_order, 0u );
+  for ( int p = 0; p < producer_count; ++p )
+    EXPECT_EQ( result.received[p], frames_per_producer ) << "producer " << p;
+  RecordProperty( "queue_full", std::to_string( queue_full.load() ) );
+}
+
+TEST( TxQueue, ConcurrentProducersDropping )
+{
+  constexpr int producer_count = 4;
+  constexpr uint32_t frames_per_producer = 50000;
+  Queue queue;
+  std::atomic<int> running_producers{ producer_count };
+  std::vector<uint32_t> pushed( producer_count );
+  ConsumerResult result;
+  result.received.resize( producer_count );
+  result.next_index.resize( producer_count );
+  std::thread consumer( [&] { consume( queue, running_producers, false, result ); } );
+  std::vector<std::thread> producers;
+  for ( int p = 0; p < producer_count; ++p ) {
+    producers.emplace_back( [&, p] {
+      // Frames are dropped if the queue is full, e.g., commands of a service handler
+      for ( uint32_t i = 0; i < frames_per_producer; ++i ) {
+        if ( queue.push( makeObject( p, i ) ) == crosstalk::WriteResult::Success )
+          ++pushed[p];
+      }
+      running_producers.fetch_sub( 1, std::memory_order_release );
+    } );
+  }
+  for ( auto &producer : producers ) producer.join();
+  consumer.join();
+
+  EXPECT_EQ( result.corrupt, 0u );
+  EXPECT_EQ( result.out_of_order, 0u );
+  // Every frame that was pushed successfully is drained, no other frame is lost
+  for ( int p = 0; p < producer_count; ++p )
+    EXPECT_EQ( result.received[p], pushed[p] ) << "producer " << p;
+}
+
+TEST( PriorityTxQueue, LowerPrioritiesLeaveReserveFree )
+{
+  // Frames of stress objects take 47 bytes, of urgent objects 12 bytes
+  crosstalk::PriorityTxQueue<64, 8> queue( 60 );
+  TxBufferTalker talker;
+  talker.capacity = 160;
+  for ( uint32_t i = 0; i < 4; ++i )
+    ASSERT_EQ( queue.push( makeObject( 0, i ) ), crosstalk::WriteResult::Success );
+  // Two frames fill the buffer up to 94 bytes, a third would cut into the reserve
+  EXPECT_EQ( queue.flush( talker ), 2u );
+  EXPECT_EQ( talker.availableForWrite(), 66 );
+  // The highest priority may use the reserve
+  for ( uint32_t i = 0; i < 6; ++i )
+    ASSERT_EQ( queue.push( UrgentObject{ i } ), crosstalk::WriteResult::Success );
+  EXPECT_EQ( queue.flush( talker ), 5u );
+  EXPECT_EQ( talker.availableForWrite(), 6 );
+  // Once the line drained the buffer, the urgent frame is sent before the remaining stress frames
+  talker.ids.clear();
+  talker.sizes.clear();
+  EXPECT_EQ( queue.flush( talker ), 2u );
+  const int16_t stress_id = crosstalk::object_id<StressObject>();
+  const int16_t urgent_id = crosstalk::object_id<UrgentObject>();
+  EXPECT_EQ( talker.ids, ( std::vector<int16_t>{ urgent_id, stress_id } ) );
+  talker.sizes.clear();
+  EXPECT_EQ( queue.flush( talker ), 1u );
+  EXPECT_TRUE( queue.empty() );
+}